@@ -0,0 +1,161 @@
+#if defined(__x86_64__) || defined(_M_X64)
+#define AFFINE_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define TARGET_AVX2
+#endif
+#include "core.h"
+
+template <AffineKind kind> void transformVerticesScalar(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count);
+template <AffineKind kind> void transformVerticesSSE2(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count);
+template <AffineKind kind> TARGET_AVX2 void transformVerticesAVX2(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count);
+
+// affine kernels for the widest instruction set the processor supports, picked at startup,
+// one per AffineKind, the kind is picked once per object
+TransformKernel transformKernels[3] = {
+    transformVerticesScalar<AffineKind::translation>,
+    transformVerticesScalar<AffineKind::scaling>,
+    transformVerticesScalar<AffineKind::general>
+};
+
+// every kernel evaluates (ax + by) + c in single precision, so they agree bit for bit,
+// the kind drops the terms that are known to be zero at compile time
+template <AffineKind kind>
+void transformVerticesScalar(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count) {
+    for (unsigned int j = 0; j < count; ++j) {
+        float x = xs[j], y = ys[j];
+        if (kind == AffineKind::translation) {
+            outX[j] = x + m[2];
+            outY[j] = y + m[5];
+        }
+        else if (kind == AffineKind::scaling) {
+            outX[j] = m[0] * x + m[2];
+            outY[j] = m[4] * y + m[5];
+        }
+        else {
+            outX[j] = m[0] * x + m[1] * y + m[2];
+            outY[j] = m[3] * x + m[4] * y + m[5];
+        }
+    }
+}
+
+#ifdef AFFINE_SIMD
+template <AffineKind kind>
+void transformVerticesSSE2(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count) {
+    __m128 a = _mm_set1_ps(m[0]), b = _mm_set1_ps(m[1]), c = _mm_set1_ps(m[2]);
+    __m128 d = _mm_set1_ps(m[3]), e = _mm_set1_ps(m[4]), f = _mm_set1_ps(m[5]);
+    unsigned int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m128 x = _mm_loadu_ps(xs + j);
+        __m128 y = _mm_loadu_ps(ys + j);
+        if (kind == AffineKind::translation) {
+            _mm_storeu_ps(outX + j, _mm_add_ps(x, c));
+            _mm_storeu_ps(outY + j, _mm_add_ps(y, f));
+        }
+        else if (kind == AffineKind::scaling) {
+            _mm_storeu_ps(outX + j, _mm_add_ps(_mm_mul_ps(a, x), c));
+            _mm_storeu_ps(outY + j, _mm_add_ps(_mm_mul_ps(e, y), f));
+        }
+        else {
+            _mm_storeu_ps(outX + j, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)), c));
+            _mm_storeu_ps(outY + j, _mm_add_ps(_mm_add_ps(_mm_mul_ps(d, x), _mm_mul_ps(e, y)), f));
+        }
+    }
+    transformVerticesScalar<kind>(m, xs + j, ys + j, outX + j, outY + j, count - j);
+}
+
+template <AffineKind kind>
+TARGET_AVX2 void transformVerticesAVX2(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count) {
+    __m256 a = _mm256_set1_ps(m[0]), b = _mm256_set1_ps(m[1]), c = _mm256_set1_ps(m[2]);
+    __m256 d = _mm256_set1_ps(m[3]), e = _mm256_set1_ps(m[4]), f = _mm256_set1_ps(m[5]);
+    unsigned int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 x = _mm256_loadu_ps(xs + j);
+        __m256 y = _mm256_loadu_ps(ys + j);
+        if (kind == AffineKind::translation) {
+            _mm256_storeu_ps(outX + j, _mm256_add_ps(x, c));
+            _mm256_storeu_ps(outY + j, _mm256_add_ps(y, f));
+        }
+        else if (kind == AffineKind::scaling) {
+            _mm256_storeu_ps(outX + j, _mm256_add_ps(_mm256_mul_ps(a, x), c));
+            _mm256_storeu_ps(outY + j, _mm256_add_ps(_mm256_mul_ps(e, y), f));
+        }
+        else {
+            _mm256_storeu_ps(outX + j, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, x), _mm256_mul_ps(b, y)), c));
+            _mm256_storeu_ps(outY + j, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d, x), _mm256_mul_ps(e, y)), f));
+        }
+    }
+    transformVerticesSSE2<kind>(m, xs + j, ys + j, outX + j, outY + j, count - j);
+}
+#else
+template <AffineKind kind>
+void transformVerticesSSE2(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count) {
+    transformVerticesScalar<kind>(m, xs, ys, outX, outY, count);
+}
+
+template <AffineKind kind>
+void transformVerticesAVX2(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count) {
+    transformVerticesScalar<kind>(m, xs, ys, outX, outY, count);
+}
+#endif
+
+InstructionSet bestInstructionSet() {
+#ifdef AFFINE_SIMD
+    // sse2 is part of x86-64, avx2 also needs the os to save the ymm registers
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    bool avx2 = avx && (info[1] & (1 << 5));
+#else
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return avx2 ? InstructionSet::avx2 : InstructionSet::sse2;
+#else
+    return InstructionSet::scalar;
+#endif
+}
+
+TransformKernel transformKernelFor(InstructionSet set, AffineKind kind) {
+    // NULL when the processor or the build cannot run it
+    if (set > bestInstructionSet()) {
+        return NULL;
+    }
+    TransformKernel kernels[3][3] = {
+        { transformVerticesScalar<AffineKind::translation>, transformVerticesScalar<AffineKind::scaling>, transformVerticesScalar<AffineKind::general> },
+#ifdef AFFINE_SIMD
+        { transformVerticesSSE2<AffineKind::translation>, transformVerticesSSE2<AffineKind::scaling>, transformVerticesSSE2<AffineKind::general> },
+        { transformVerticesAVX2<AffineKind::translation>, transformVerticesAVX2<AffineKind::scaling>, transformVerticesAVX2<AffineKind::general> }
+#endif
+    };
+    return kernels[(unsigned int)set][(unsigned int)kind];
+}
+
+void selectTransformKernel(bool specialized) {
+    // without specialization every kind gets the general kernel, the baseline the benchmark compares with
+    InstructionSet set = bestInstructionSet();
+    for (unsigned int kind = 0; kind < 3; ++kind) {
+        transformKernels[kind] = transformKernelFor(set, specialized ? (AffineKind)kind : AffineKind::general);
+    }
+}
+
+AffineKind affineKind(const float* m) {
+    if (m[1] != 0.0f || m[3] != 0.0f) {
+        return AffineKind::general;
+    }
+    if (m[0] != 1.0f || m[4] != 1.0f) {
+        return AffineKind::scaling;
+    }
+    return AffineKind::translation;
+}
+
+TransformKernel transformKernel(const float* m) {
+    return transformKernels[(unsigned int)affineKind(m)];
+}
@@ -0,0 +1,316 @@
+#pragma once
+// geometry core, scene storage, indexing, transformations and fill hit testing, without any GL or window
+#include <vector>
+#include <map>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// class definitions
+enum class Transformation : unsigned int {
+    none,
+    translation,
+    scaling,
+    rotation,
+    reflectionX,
+    reflectionY,
+    reflectionOrigin,
+    shearX,
+    shearY
+};
+
+// shape of a 2x3 affine, each gets its own kernel
+enum class AffineKind : unsigned int {
+    translation,
+    scaling,
+    general
+};
+
+// instruction sets the affine kernels are built for, from narrowest to widest
+enum class InstructionSet : unsigned int {
+    scalar,
+    sse2,
+    avx2
+};
+
+// inputs the editor reacts to, frame marks where a frame was drawn between them
+enum class EventType : unsigned char {
+    frame,
+    cursor,
+    mouseButton,
+    character,
+    keys,
+    drop
+};
+
+enum class ObjectType : unsigned int {
+    line,
+    polygon,
+    fill
+};
+
+// every object in the scene, stored as a structure of arrays
+struct Scene {
+    // vertex coordinates, shared by all objects
+    std::vector<float> x;
+    std::vector<float> y;
+    // object every vertex belongs to, read by the vertex shader
+    std::vector<unsigned int> objects;
+    // object tables, one entry per object
+    std::vector<unsigned int> ids;
+    std::vector<ObjectType> types;
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> counts;
+    // bounding box of every object's own vertices, before its transform
+    std::vector<float> minX;
+    std::vector<float> minY;
+    std::vector<float> maxX;
+    std::vector<float> maxY;
+    // composed 2x3 affine of every object, x' = ax + by + c and y' = dx + ey + f,
+    // kept in double precision until it is baked into the vertices
+    std::vector<double> transforms;
+    unsigned int nextId = 0;
+};
+
+// uniform grid over object bounding boxes, covering the canvas
+struct SpatialGrid {
+    int size = 0;
+    std::vector<std::vector<unsigned int>> cells;
+    // objects whose boxes span too many cells to be registered in each of them
+    std::vector<unsigned int> large;
+    // cell rectangle every object was registered with, starting with -1 when absent and -2 when large
+    std::vector<int> ranges;
+};
+
+// edges of one polygon bucketed into horizontal bands, edge k runs from vertex k to vertex k + 1
+struct EdgeBands {
+    float minY;
+    float bandHeight;
+    std::vector<unsigned int> firsts;
+    std::vector<unsigned int> edges;
+};
+
+// vertex ranges modified since the last upload
+struct DirtyRanges {
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> counts;
+};
+
+// the scene with everything derived from it, and what changed since it was last uploaded
+struct Document {
+    Scene scene;
+    // line or polygon still being drawn, -1 when there is none
+    int openObject = -1;
+    // every finished object is indexed by its box, so hit tests and the selection window only look nearby,
+    // polygons also keep their edges banded by height
+    SpatialGrid grid;
+    std::map<int, EdgeBands> edgeBands;
+    // triangle lists of filled polygons, keyed by polygon id, in the polygon's own vertex numbering
+    std::map<unsigned int, std::vector<unsigned int>> triangulations;
+    // polygon every fill copies, by id
+    std::map<unsigned int, unsigned int> fillSources;
+    // vertex ranges and objects whose transforms changed
+    DirtyRanges sceneDirty;
+    DirtyRanges transformDirty;
+};
+
+// workers that split a loop into chunks, the calling thread takes chunks too
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    // the current loop, chunks are claimed by bumping next
+    std::function<void(unsigned int, unsigned int)> job;
+    unsigned int count = 0;
+    unsigned int chunk = 1;
+    std::atomic<unsigned int> next{ 0 };
+    // workers inside the current loop
+    unsigned int busy = 0;
+    unsigned int generation = 0;
+    bool stopping = false;
+};
+
+// metrics of one glyph in pixels, and where it sits in the atlas
+struct Glyph {
+    float uvMin[2];
+    float uvMax[2];
+    int size[2];
+    int bearing[2];
+    // in 1/64 pixels
+    unsigned int advance;
+};
+
+// one recorded input, time is in microseconds since the recording started
+struct InputEvent {
+    EventType type;
+    unsigned long long time;
+    // cursor position in pixels, for cursor and mouse button events
+    float x;
+    float y;
+    int button;
+    int action;
+    int mods;
+    // codepoint of a character, bits of the keys held down for keys
+    unsigned int value;
+    // file dropped on the window
+    std::string path;
+};
+
+// event file being written, events are encoded into buffer and written out in blocks
+struct EventRecorder {
+    std::ofstream file;
+    std::vector<unsigned char> buffer;
+    unsigned long long lastTime = 0;
+};
+
+// what generateScene adds, everything is placed in normalized coordinates
+struct SceneSettings {
+    unsigned int seed = 1;
+    unsigned int lines = 0;
+    unsigned int convexPolygons = 0;
+    unsigned int concavePolygons = 0;
+    // vertex count of every polygon is picked between these, concave ones have at least 5
+    unsigned int minVertices = 3;
+    unsigned int maxVertices = 8;
+    // polygons that also get filled, spread evenly over all of them
+    unsigned int fills = 0;
+    // length of lines and diameter of polygons
+    float minSize = 0.02f;
+    float maxSize = 0.2f;
+};
+
+// scene file mapped into memory, its vertex columns and transform texels are laid out like the GPU buffers
+struct MappedScene {
+    const unsigned char* data = NULL;
+    size_t size = 0;
+    unsigned int objectCount = 0;
+    unsigned int vertexCount = 0;
+    const float* x = NULL;
+    const float* y = NULL;
+    const unsigned int* objects = NULL;
+    // two rows of four floats per object
+    const float* texels = NULL;
+};
+
+// shapes read from an imported file, in normalized coordinates, vertices of all shapes follow each other
+struct ImportBatch {
+    std::vector<ObjectType> types;
+    std::vector<unsigned int> counts;
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+// file being read on its own thread, batches queue up until the editor takes them
+struct Importer {
+    std::thread thread;
+    std::mutex mutex;
+    // signalled when a batch is taken or the import is cancelled, and when a batch is queued or the reading ends
+    std::condition_variable space;
+    std::condition_variable ready;
+    std::deque<ImportBatch> batches;
+    bool finished = true;
+    std::atomic<bool> cancelled{ false };
+};
+
+// applies a 2x3 affine to count vertices, the output may alias the input
+typedef void (*TransformKernel)(const float* m, const float* xs, const float* ys, float* outX, float* outY, unsigned int count);
+
+// function declarations
+// scene
+unsigned int addObject(Scene& scene, ObjectType type);
+void appendVertex(Scene& scene, float x, float y);
+void popObject(Scene& scene);
+void clearScene(Scene& scene);
+int findObject(const Scene& scene, unsigned int id);
+void updateBounds(Scene& scene, int object);
+void worldBounds(const Scene& scene, int object, float* bounds);
+void composeTransform(Scene& scene, int object, const double* op);
+bool invertTransform(const Scene& scene, int object, float x, float y, float* localX, float* localY);
+bool isIdentity(const Scene& scene, int object);
+void bakeTransform(Scene& scene, int object);
+bool objectInWindow(const Scene& scene, int object, float xMin, float yMin, float xMax, float yMax, std::vector<float>& worldXs, std::vector<float>& worldYs);
+bool pointInObject(const Scene& scene, int object, float x, float y);
+bool closesPolygon(const Scene& scene, int object, float x, float y);
+void normalizeCoordinates(float* x, float* y, unsigned int width, unsigned int height);
+void markDirty(DirtyRanges& dirty, unsigned int offset, unsigned int count);
+void coalesceDirty(DirtyRanges& dirty, unsigned int gap);
+// document
+void initDocument(Document& document, int gridSize);
+void clearDocument(Document& document);
+void dropOpenObject(Document& document);
+void indexObject(Document& document, int object);
+int addLinePoint(Document& document, float x, float y);
+int addPolygonPoint(Document& document, float x, float y);
+void polygonsAtPoint(const Document& document, float x, float y, std::vector<unsigned int>& polygons);
+int fillPolygon(Document& document, int polygon);
+void floodFill(Document& document, float x, float y, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons);
+void transformationMatrix(Transformation transformation, float x, float y, unsigned int width, unsigned int height, double* op);
+unsigned int transformSelection(Document& document, ThreadPool& pool, float xMin, float yMin, float xMax, float yMax, const double* op);
+bool bakeTransforms(Document& document, ThreadPool& pool);
+// grid
+void initGrid(SpatialGrid& grid, int size);
+void clearGrid(SpatialGrid& grid);
+int gridCell(const SpatialGrid& grid, float value);
+void insertIntoGrid(SpatialGrid& grid, const Scene& scene, int object);
+void removeFromGrid(SpatialGrid& grid, int object);
+void queryGrid(const SpatialGrid& grid, float x, float y, std::vector<unsigned int>& candidates);
+void queryGridWindow(const SpatialGrid& grid, float xMin, float yMin, float xMax, float yMax, std::vector<unsigned int>& candidates);
+void buildEdgeBands(const Scene& scene, int object, EdgeBands& bands);
+bool pointInBands(const Scene& scene, int object, const EdgeBands& bands, float x, float y);
+// affine kernels
+InstructionSet bestInstructionSet();
+TransformKernel transformKernelFor(InstructionSet set, AffineKind kind);
+void selectTransformKernel(bool specialized = true);
+AffineKind affineKind(const float* m);
+TransformKernel transformKernel(const float* m);
+// threads
+void startThreadPool(ThreadPool& pool, unsigned int threads);
+void stopThreadPool(ThreadPool& pool);
+void runChunks(ThreadPool& pool);
+void parallelFor(ThreadPool& pool, unsigned int count, const std::function<void(unsigned int, unsigned int)>& job);
+// triangulation
+bool triangulatePolygon(const float* xs, const float* ys, unsigned int count, std::vector<unsigned int>& triangles);
+// generator
+void generateScene(Document& document, const SceneSettings& settings, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons);
+// scene files
+bool saveScene(const Document& document, ThreadPool& pool, const char* path);
+bool loadScene(Document& document, ThreadPool& pool, const char* path, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons);
+void indexLoadedScene(Document& document, ThreadPool& pool, const std::vector<unsigned int>& sources,
+    std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons);
+bool saveMappedScene(const Document& document, const char* path);
+bool isMappedScene(const char* path);
+bool openMappedScene(MappedScene& mapped, const char* path);
+void closeMappedScene(MappedScene& mapped);
+bool loadMappedScene(Document& document, ThreadPool& pool, const MappedScene& mapped, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons);
+// import
+bool startImport(Importer& importer, const char* path, unsigned int width, unsigned int height);
+bool takeImportBatch(Importer& importer, ImportBatch& batch);
+bool waitImportBatch(Importer& importer, ImportBatch& batch);
+bool importRunning(Importer& importer);
+void stopImport(Importer& importer);
+void appendImportBatch(Document& document, const ImportBatch& batch);
+// export
+bool exportSvg(const Document& document, const char* path, unsigned int width, unsigned int height);
+// binary encoding
+void writeVarint(std::vector<unsigned char>& buffer, unsigned long long value);
+void writeFloat(std::vector<unsigned char>& buffer, float value);
+void writeDouble(std::vector<unsigned char>& buffer, double value);
+bool readVarint(const std::vector<unsigned char>& data, size_t& position, unsigned long long* value);
+bool readFloat(const std::vector<unsigned char>& data, size_t& position, float* value);
+bool readDouble(const std::vector<unsigned char>& data, size_t& position, double* value);
+unsigned int zigzag(int value);
+int unzigzag(unsigned int value);
+// events
+bool startRecording(EventRecorder& recorder, const char* path);
+void recordEvent(EventRecorder& recorder, const InputEvent& event);
+void stopRecording(EventRecorder& recorder);
+bool readEvents(const char* path, std::vector<InputEvent>& events);
+// text
+void layoutText(const std::map<char, Glyph>& glyphs, const std::string& text, float x, float y, float scale, const float* color,
+    unsigned int width, unsigned int height, std::vector<float>& vertices);
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <math.h>
+#include "core.h"
+
+void initDocument(Document& document, int gridSize) {
+    clearDocument(document);
+    initGrid(document.grid, gridSize);
+}
+
+void clearDocument(Document& document) {
+    clearScene(document.scene);
+    document.openObject = -1;
+    clearGrid(document.grid);
+    document.edgeBands.clear();
+    document.triangulations.clear();
+    document.fillSources.clear();
+    document.sceneDirty.offsets.clear();
+    document.sceneDirty.counts.clear();
+    document.transformDirty.offsets.clear();
+    document.transformDirty.counts.clear();
+}
+
+void dropOpenObject(Document& document) {
+    // the line or polygon that was not finished
+    if (document.openObject != -1) {
+        popObject(document.scene);
+        document.openObject = -1;
+    }
+}
+
+void indexObject(Document& document, int object) {
+    insertIntoGrid(document.grid, document.scene, object);
+    if (document.scene.types[object] == ObjectType::polygon) {
+        buildEdgeBands(document.scene, object, document.edgeBands[object]);
+    }
+}
+
+int addLinePoint(Document& document, float x, float y) {
+    // returns the line once its second end point is in
+    Scene& scene = document.scene;
+    int finished = -1;
+    if (document.openObject == -1) {
+        document.openObject = scene.ids.size();
+        addObject(scene, ObjectType::line);
+        appendVertex(scene, x, y);
+        markDirty(document.transformDirty, document.openObject, 1);
+    }
+    else {
+        appendVertex(scene, x, y);
+        indexObject(document, document.openObject);
+        finished = document.openObject;
+        document.openObject = -1;
+    }
+    markDirty(document.sceneDirty, scene.x.size() - 1, 1);
+    return finished;
+}
+
+int addPolygonPoint(Document& document, float x, float y) {
+    // returns the polygon once a point lands on its first vertex
+    Scene& scene = document.scene;
+    if (document.openObject == -1) {
+        document.openObject = scene.ids.size();
+        addObject(scene, ObjectType::polygon);
+        appendVertex(scene, x, y);
+        markDirty(document.sceneDirty, scene.x.size() - 1, 1);
+        markDirty(document.transformDirty, document.openObject, 1);
+    }
+    else if (closesPolygon(scene, document.openObject, x, y)) {
+        int finished = document.openObject;
+        indexObject(document, finished);
+        document.openObject = -1;
+        return finished;
+    }
+    else {
+        appendVertex(scene, x, y);
+        markDirty(document.sceneDirty, scene.x.size() - 1, 1);
+    }
+    return -1;
+}
+
+void polygonsAtPoint(const Document& document, float x, float y, std::vector<unsigned int>& polygons) {
+    const Scene& scene = document.scene;
+
+    // candidates come back in any order, polygons are reported in drawing order
+    std::vector<unsigned int> candidates;
+    queryGrid(document.grid, x, y, candidates);
+    std::sort(candidates.begin(), candidates.end());
+    for (int i : candidates) {
+        if (scene.types[i] != ObjectType::polygon) {
+            continue;
+        }
+        // outlines and their bands stay in the polygon's own space, the point is brought there instead
+        float localX, localY;
+        if (!invertTransform(scene, i, x, y, &localX, &localY)) {
+            continue;
+        }
+        if (localX < scene.minX[i] || localX > scene.maxX[i] || localY < scene.minY[i] || localY > scene.maxY[i]) {
+            continue;
+        }
+        auto bands = document.edgeBands.find(i);
+        if (bands != document.edgeBands.end() && pointInBands(scene, i, bands->second, localX, localY)) {
+            polygons.push_back(i);
+        }
+    }
+}
+
+int fillPolygon(Document& document, int polygon) {
+    // adds a fill over the polygon and returns it, the triangulation is kept under the polygon's id
+    Scene& scene = document.scene;
+    unsigned int first = scene.offsets[polygon];
+    unsigned int count = scene.counts[polygon];
+
+    // affine transformations keep a triangulation valid, so each polygon is only triangulated once
+    if (document.triangulations.find(scene.ids[polygon]) == document.triangulations.end()) {
+        std::vector<unsigned int> triangles;
+        if (!triangulatePolygon(&scene.x[first], &scene.y[first], count, triangles)) {
+            // self-intersecting outline, fall back to a fan
+            triangles.clear();
+            for (unsigned int k = 1; k + 1 < count; ++k) {
+                triangles.push_back(0);
+                triangles.push_back(k);
+                triangles.push_back(k + 1);
+            }
+        }
+        document.triangulations.insert(std::make_pair(scene.ids[polygon], triangles));
+    }
+
+    scene.x.reserve(scene.x.size() + count);
+    scene.y.reserve(scene.y.size() + count);
+    int fill = scene.ids.size();
+    addObject(scene, ObjectType::fill);
+    for (unsigned int j = first; j < first + count; ++j) {
+        appendVertex(scene, scene.x[j], scene.y[j]);
+    }
+    // the fill follows the polygon's transform
+    std::copy(&scene.transforms[6 * polygon], &scene.transforms[6 * polygon] + 6, scene.transforms.end() - 6);
+    markDirty(document.sceneDirty, scene.offsets[fill], count);
+    markDirty(document.transformDirty, fill, 1);
+    indexObject(document, fill);
+    document.fillSources[scene.ids[fill]] = scene.ids[polygon];
+    return fill;
+}
+
+void floodFill(Document& document, float x, float y, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons) {
+    // adds a fill for every polygon around the point, reporting each with the polygon it copies
+    unsigned int firstPolygon = polygons.size();
+    polygonsAtPoint(document, x, y, polygons);
+    for (unsigned int k = firstPolygon; k < polygons.size(); ++k) {
+        fills.push_back(fillPolygon(document, polygons[k]));
+    }
+}
+
+void transformationMatrix(Transformation transformation, float x, float y, unsigned int width, unsigned int height, double* op) {
+    // the operation as a 2x3 affine, offsets and shear factors are given in pixels
+    op[0] = 1.0;
+    op[1] = 0.0;
+    op[2] = 0.0;
+    op[3] = 0.0;
+    op[4] = 1.0;
+    op[5] = 0.0;
+
+    if (transformation == Transformation::reflectionX) {
+        op[4] = -1.0;
+    }
+    else if (transformation == Transformation::reflectionY) {
+        op[0] = -1.0;
+    }
+    else if (transformation == Transformation::reflectionOrigin) {
+        op[0] = -1.0;
+        op[4] = -1.0;
+    }
+    else if (transformation == Transformation::translation) {
+        op[2] = (double)x / width;
+        op[5] = (double)y / height;
+    }
+    else if (transformation == Transformation::scaling) {
+        op[0] = x;
+        op[4] = y;
+    }
+    else if (transformation == Transformation::rotation) {
+        double angle = x * acos(-1.0) / 180.0;
+        op[0] = cos(angle);
+        op[1] = -sin(angle);
+        op[3] = sin(angle);
+        op[4] = cos(angle);
+    }
+    else if (transformation == Transformation::shearX) {
+        op[1] = (double)x / width;
+    }
+    else if (transformation == Transformation::shearY) {
+        op[3] = (double)x / height;
+    }
+}
+
+unsigned int transformSelection(Document& document, ThreadPool& pool, float xMin, float yMin, float xMax, float yMax, const double* op) {
+    // applies op to every object inside the window, returning how many there were
+    Scene& scene = document.scene;
+    std::vector<unsigned int> candidates;
+    queryGridWindow(document.grid, xMin, yMin, xMax, yMax, candidates);
+
+    // containment only reads the scene, so candidates are tested in parallel and transformed afterwards
+    std::vector<char> selected(candidates.size(), 0);
+    parallelFor(pool, candidates.size(), [&](unsigned int begin, unsigned int end) {
+        std::vector<float> worldXs, worldYs;
+        for (unsigned int k = begin; k < end; ++k) {
+            selected[k] = objectInWindow(scene, candidates[k], xMin, yMin, xMax, yMax, worldXs, worldYs);
+        }
+    });
+
+    unsigned int count = 0;
+    for (int k = 0; k < candidates.size(); ++k) {
+        if (selected[k]) {
+            int i = candidates[k];
+            composeTransform(scene, i, op);
+            markDirty(document.transformDirty, i, 1);
+            // vertices and edge bands are untouched, only the grid follows the new world box
+            removeFromGrid(document.grid, i);
+            insertIntoGrid(document.grid, scene, i);
+            count++;
+        }
+    }
+    return count;
+}
+
+bool bakeTransforms(Document& document, ThreadPool& pool) {
+    // writes every pending transform into the vertices, for anything that needs the raw coordinates
+    Scene& scene = document.scene;
+    std::vector<unsigned int> pending;
+    for (int i = 0; i < scene.ids.size(); ++i) {
+        if (!isIdentity(scene, i)) {
+            pending.push_back(i);
+        }
+    }
+    if (pending.empty()) {
+        return false;
+    }
+
+    // objects own disjoint vertex ranges, so they bake independently
+    parallelFor(pool, pending.size(), [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; ++k) {
+            bakeTransform(scene, pending[k]);
+        }
+    });
+
+    for (int i : pending) {
+        markDirty(document.sceneDirty, scene.offsets[i], scene.counts[i]);
+        markDirty(document.transformDirty, i, 1);
+        if (i != document.openObject) {
+            removeFromGrid(document.grid, i);
+            indexObject(document, i);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#include <string.h>
+#include "core.h"
+
+// little endian values and varints shared by the file formats
+
+void writeVarint(std::vector<unsigned char>& buffer, unsigned long long value) {
+    // seven bits per byte, the high bit says another byte follows
+    while (value >= 0x80) {
+        buffer.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((unsigned char)value);
+}
+
+void writeFloat(std::vector<unsigned char>& buffer, float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int k = 0; k < 4; ++k) {
+        buffer.push_back((unsigned char)(bits >> (8 * k)));
+    }
+}
+
+bool readVarint(const std::vector<unsigned char>& data, size_t& position, unsigned long long* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && position < data.size(); shift += 7) {
+        unsigned char byte = data[position++];
+        *value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readFloat(const std::vector<unsigned char>& data, size_t& position, float* value) {
+    if (position + 4 > data.size()) {
+        return false;
+    }
+    unsigned int bits = 0;
+    for (int k = 0; k < 4; ++k) {
+        bits |= (unsigned int)data[position++] << (8 * k);
+    }
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
+
+void writeDouble(std::vector<unsigned char>& buffer, double value) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int k = 0; k < 8; ++k) {
+        buffer.push_back((unsigned char)(bits >> (8 * k)));
+    }
+}
+
+bool readDouble(const std::vector<unsigned char>& data, size_t& position, double* value) {
+    if (position + 8 > data.size()) {
+        return false;
+    }
+    unsigned long long bits = 0;
+    for (int k = 0; k < 8; ++k) {
+        bits |= (unsigned long long)data[position++] << (8 * k);
+    }
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
+
+unsigned int zigzag(int value) {
+    // small magnitudes of either sign become small unsigned numbers
+    return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+int unzigzag(unsigned int value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <string.h>
+#include "core.h"
+
+// file layout: "CGEV", a version byte, then one record per event, a type byte and the time since the
+// previous event as a varint, followed by the event's own fields, multi-byte values are little endian,
+// version 2 added drops, whose path is its length as a varint and its bytes, and still reads version 1
+const char EVENT_MAGIC[4] = { 'C', 'G', 'E', 'V' };
+const unsigned char EVENT_VERSION = 2;
+const unsigned int EVENT_BLOCK = 1 << 16;
+
+bool startRecording(EventRecorder& recorder, const char* path) {
+    recorder.file.open(path, std::ios::binary);
+    if (!recorder.file) {
+        std::cout << "Failed to open " << path << " for recording" << std::endl;
+        return false;
+    }
+    recorder.file.write(EVENT_MAGIC, 4);
+    recorder.file.put(EVENT_VERSION);
+    recorder.buffer.clear();
+    recorder.lastTime = 0;
+    return true;
+}
+
+void recordEvent(EventRecorder& recorder, const InputEvent& event) {
+    std::vector<unsigned char>& buffer = recorder.buffer;
+    buffer.push_back((unsigned char)event.type);
+    writeVarint(buffer, event.time - recorder.lastTime);
+    recorder.lastTime = event.time;
+    if (event.type == EventType::cursor) {
+        writeFloat(buffer, event.x);
+        writeFloat(buffer, event.y);
+    }
+    else if (event.type == EventType::mouseButton) {
+        buffer.push_back((unsigned char)event.button);
+        buffer.push_back((unsigned char)event.action);
+        buffer.push_back((unsigned char)event.mods);
+        writeFloat(buffer, event.x);
+        writeFloat(buffer, event.y);
+    }
+    else if (event.type == EventType::character || event.type == EventType::keys) {
+        writeVarint(buffer, event.value);
+    }
+    else if (event.type == EventType::drop) {
+        writeVarint(buffer, event.path.size());
+        buffer.insert(buffer.end(), event.path.begin(), event.path.end());
+    }
+
+    if (buffer.size() >= EVENT_BLOCK) {
+        recorder.file.write((const char*)buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void stopRecording(EventRecorder& recorder) {
+    if (recorder.file.is_open()) {
+        recorder.file.write((const char*)recorder.buffer.data(), recorder.buffer.size());
+        recorder.buffer.clear();
+        if (!recorder.file) {
+            std::cout << "Failed to write the recorded events" << std::endl;
+        }
+        recorder.file.close();
+    }
+}
+
+bool readEvents(const char* path, std::vector<InputEvent>& events) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 5 || memcmp(data.data(), EVENT_MAGIC, 4) != 0 || data[4] == 0 || data[4] > EVENT_VERSION) {
+        std::cout << path << " is not an event recording" << std::endl;
+        return false;
+    }
+
+    size_t position = 5;
+    unsigned long long time = 0;
+    while (position < data.size()) {
+        InputEvent event = {};
+        unsigned char type = data[position++];
+        unsigned long long delta;
+        bool complete = type <= (unsigned char)EventType::drop && readVarint(data, position, &delta);
+        if (complete) {
+            event.type = (EventType)type;
+            time += delta;
+            event.time = time;
+            if (event.type == EventType::cursor) {
+                complete = readFloat(data, position, &event.x) && readFloat(data, position, &event.y);
+            }
+            else if (event.type == EventType::mouseButton) {
+                complete = position + 3 <= data.size();
+                if (complete) {
+                    event.button = data[position++];
+                    event.action = data[position++];
+                    event.mods = data[position++];
+                    complete = readFloat(data, position, &event.x) && readFloat(data, position, &event.y);
+                }
+            }
+            else if (event.type == EventType::character || event.type == EventType::keys) {
+                unsigned long long value;
+                complete = readVarint(data, position, &value);
+                event.value = (unsigned int)value;
+            }
+            else if (event.type == EventType::drop) {
+                unsigned long long length;
+                complete = readVarint(data, position, &length) && length <= data.size() - position;
+                if (complete) {
+                    event.path.assign(data.begin() + position, data.begin() + position + length);
+                    position += length;
+                }
+            }
+        }
+        if (!complete) {
+            // a recording cut short keeps everything before the damaged event
+            std::cout << path << " is truncated after " << events.size() << " events" << std::endl;
+            break;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
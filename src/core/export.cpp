@@ -0,0 +1,137 @@
+#include <iostream>
+#include <math.h>
+#include <string.h>
+#include "core.h"
+
+// SVG export of everything on the canvas, drawn the way the editor draws it: outlines first, then fills
+// on top, all in black. Transforms are applied to the coordinates, which are written in pixels of the
+// canvas to a hundredth of a pixel. The document is streamed through a fixed buffer, nothing is kept
+// for the whole file, so memory does not grow with the scene.
+const unsigned int WRITE_BLOCK = 1 << 16;
+// room for one coordinate pair with its separators
+const unsigned int PAIR_BYTES = 64;
+
+// file written through a buffer of WRITE_BLOCK bytes
+struct SvgWriter {
+    std::ofstream file;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+void flushWriter(SvgWriter& writer) {
+    writer.file.write(writer.buffer.data(), writer.used);
+    writer.used = 0;
+}
+
+void writeText(SvgWriter& writer, const char* text) {
+    size_t length = strlen(text);
+    if (writer.used + length > writer.buffer.size()) {
+        flushWriter(writer);
+    }
+    if (length > writer.buffer.size()) {
+        writer.file.write(text, length);
+        return;
+    }
+    memcpy(&writer.buffer[writer.used], text, length);
+    writer.used += length;
+}
+
+char* formatCoordinate(char* out, double value) {
+    // hundredths of a pixel, without trailing zeros, snprintf is many times slower
+    value = fmin(fmax(value, -1e12), 1e12);
+    long long hundredths = llround(value * 100.0);
+    if (hundredths < 0) {
+        *out++ = '-';
+        hundredths = -hundredths;
+    }
+    char digits[24];
+    int length = 0;
+    long long whole = hundredths / 100;
+    do {
+        digits[length++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    while (length > 0) {
+        *out++ = digits[--length];
+    }
+    int fraction = (int)(hundredths % 100);
+    if (fraction != 0) {
+        *out++ = '.';
+        *out++ = (char)('0' + fraction / 10);
+        if (fraction % 10 != 0) {
+            *out++ = (char)('0' + fraction % 10);
+        }
+    }
+    return out;
+}
+
+void writePoints(SvgWriter& writer, const Scene& scene, int object, unsigned int width, unsigned int height) {
+    // the object's vertices through its transform, from normalized coordinates to pixels with y going down
+    const double* m = &scene.transforms[6 * object];
+    unsigned int first = scene.offsets[object];
+    for (unsigned int j = first; j < first + scene.counts[object]; ++j) {
+        if (writer.used + PAIR_BYTES > writer.buffer.size()) {
+            flushWriter(writer);
+        }
+        double x = m[0] * scene.x[j] + m[1] * scene.y[j] + m[2];
+        double y = m[3] * scene.x[j] + m[4] * scene.y[j] + m[5];
+        char* out = &writer.buffer[writer.used];
+        if (j != first) {
+            *out++ = ' ';
+        }
+        out = formatCoordinate(out, (x + 1.0) * width / 2.0);
+        *out++ = ',';
+        out = formatCoordinate(out, (1.0 - y) * height / 2.0);
+        writer.used = out - writer.buffer.data();
+    }
+}
+
+bool exportSvg(const Document& document, const char* path, unsigned int width, unsigned int height) {
+    // everything but a line or polygon still being drawn, which is always the last object
+    const Scene& scene = document.scene;
+    unsigned int objectCount = document.openObject == -1 ? scene.ids.size() : document.openObject;
+
+    SvgWriter writer;
+    writer.file.open(path, std::ios::binary);
+    if (!writer.file) {
+        std::cout << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    writer.buffer.resize(WRITE_BLOCK);
+
+    std::string size = std::to_string(width) + "\" height=\"" + std::to_string(height) + "\" viewBox=\"0 0 " +
+        std::to_string(width) + " " + std::to_string(height);
+    writeText(writer, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    writeText(writer, size.c_str());
+    writeText(writer, "\">\n<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n");
+
+    // outlines, lines are open and polygons close back to their first vertex
+    writeText(writer, "<g fill=\"none\" stroke=\"black\" stroke-width=\"1\">\n");
+    for (unsigned int i = 0; i < objectCount; ++i) {
+        if (scene.types[i] != ObjectType::fill) {
+            writeText(writer, scene.types[i] == ObjectType::line ? "<polyline points=\"" : "<polygon points=\"");
+            writePoints(writer, scene, i, width, height);
+            writeText(writer, "\"/>\n");
+        }
+    }
+    writeText(writer, "</g>\n");
+
+    // a fill has the outline of the polygon it was made from, and is drawn over the outlines
+    writeText(writer, "<g fill=\"black\" stroke=\"none\">\n");
+    for (unsigned int i = 0; i < objectCount; ++i) {
+        if (scene.types[i] == ObjectType::fill) {
+            writeText(writer, "<polygon points=\"");
+            writePoints(writer, scene, i, width, height);
+            writeText(writer, "\"/>\n");
+        }
+    }
+    writeText(writer, "</g>\n</svg>\n");
+    flushWriter(writer);
+
+    writer.file.close();
+    if (!writer.file) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#include <random>
+#include <algorithm>
+#include <math.h>
+#include "core.h"
+
+// uniform in [0, 1), mt19937 gives the same numbers everywhere but the standard distributions do not
+float unitRandom(std::mt19937& random) {
+    return (random() >> 8) * (1.0f / 16777216.0f);
+}
+
+float randomBetween(std::mt19937& random, float low, float high) {
+    return low + (high - low) * unitRandom(random);
+}
+
+void generateScene(Document& document, const SceneSettings& settings, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons) {
+    // appends finished, indexed objects straight into the document, the same seed always gives the same scene
+    Scene& scene = document.scene;
+    std::mt19937 random(settings.seed);
+    const float tau = 2.0f * (float)acos(-1.0);
+    float minSize = std::min(settings.minSize, settings.maxSize);
+    float maxSize = std::max(settings.minSize, settings.maxSize);
+    unsigned int minVertices = std::max(3u, std::min(settings.minVertices, settings.maxVertices));
+    unsigned int maxVertices = std::max(minVertices, settings.maxVertices);
+
+    dropOpenObject(document);
+    unsigned int firstVertex = scene.x.size();
+    unsigned int firstObject = scene.ids.size();
+
+    // vertex counts are picked up front so the columns grow once
+    unsigned int polygonCount = settings.convexPolygons + settings.concavePolygons;
+    std::vector<unsigned int> sizes(polygonCount);
+    size_t vertices = scene.x.size() + 2 * (size_t)settings.lines;
+    for (unsigned int i = 0; i < polygonCount; ++i) {
+        unsigned int low = i < settings.convexPolygons ? minVertices : std::max(5u, minVertices);
+        unsigned int high = std::max(low, maxVertices);
+        sizes[i] = low + random() % (high - low + 1);
+        vertices += sizes[i];
+    }
+    scene.x.reserve(vertices);
+    scene.y.reserve(vertices);
+    scene.objects.reserve(vertices);
+
+    for (unsigned int i = 0; i < settings.lines; ++i) {
+        float x = randomBetween(random, -0.95f, 0.95f);
+        float y = randomBetween(random, -0.95f, 0.95f);
+        float length = randomBetween(random, minSize, maxSize);
+        float angle = randomBetween(random, 0.0f, tau);
+        addObject(scene, ObjectType::line);
+        appendVertex(scene, x, y);
+        appendVertex(scene, x + length * cos(angle), y + length * sin(angle));
+        indexObject(document, scene.ids.size() - 1);
+    }
+
+    // counterclockwise outlines around a center, with the angles jittered inside even steps,
+    // convex ones keep every vertex on the circle, concave ones pull every other vertex inwards
+    std::vector<float> angles;
+    for (unsigned int i = 0; i < polygonCount; ++i) {
+        bool concave = i >= settings.convexPolygons;
+        float x = randomBetween(random, -0.95f, 0.95f);
+        float y = randomBetween(random, -0.95f, 0.95f);
+        float radius = 0.5f * randomBetween(random, minSize, maxSize);
+        float start = randomBetween(random, 0.0f, tau);
+        float step = tau / sizes[i];
+        // a pulled vertex is only reflex while its neighbours on the circle are less than half a turn apart,
+        // so concave outlines jitter less, keeping that gap below 0.45 of a turn
+        float jitter = concave ? std::min(0.8f, 0.45f * sizes[i] - 2.0f) : 0.8f;
+        angles.resize(sizes[i]);
+        for (unsigned int k = 0; k < sizes[i]; ++k) {
+            angles[k] = start + step * (k + jitter * unitRandom(random));
+        }
+        addObject(scene, ObjectType::polygon);
+        for (unsigned int k = 0; k < sizes[i]; ++k) {
+            float r = radius;
+            if (concave && k % 2 == 1) {
+                // strictly inside the chord between the neighbours, whose distance from the center is at least r cos(gap / 2)
+                float gap = (k + 1 < sizes[i] ? angles[k + 1] : angles[0] + tau) - angles[k - 1];
+                r = radius * cos(0.5f * gap) * randomBetween(random, 0.3f, 0.8f);
+            }
+            appendVertex(scene, x + r * cos(angles[k]), y + r * sin(angles[k]));
+        }
+        indexObject(document, scene.ids.size() - 1);
+    }
+    markDirty(document.sceneDirty, firstVertex, scene.x.size() - firstVertex);
+    markDirty(document.transformDirty, firstObject, scene.ids.size() - firstObject);
+
+    unsigned int fillCount = std::min(settings.fills, polygonCount);
+    for (unsigned int k = 0; k < fillCount; ++k) {
+        int polygon = firstObject + settings.lines + (unsigned int)((size_t)k * polygonCount / fillCount);
+        fills.push_back(fillPolygon(document, polygon));
+        polygons.push_back(polygon);
+    }
+}
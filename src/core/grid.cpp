@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <math.h>
+#include "core.h"
+
+// objects spanning more cells than this go to the large list instead
+const int LARGE_OBJECT_CELLS = 256;
+
+void initGrid(SpatialGrid& grid, int size) {
+    grid.size = size;
+    grid.cells.assign(size * size, std::vector<unsigned int>());
+    grid.large.clear();
+    grid.ranges.clear();
+}
+
+void clearGrid(SpatialGrid& grid) {
+    for (auto& cell : grid.cells) {
+        cell.clear();
+    }
+    grid.large.clear();
+    grid.ranges.clear();
+}
+
+int gridCell(const SpatialGrid& grid, float value) {
+    // anything outside the canvas lands in the border cells
+    int cell = (int)floor((value + 1.0f) * 0.5f * grid.size);
+    return std::max(0, std::min(cell, grid.size - 1));
+}
+
+void insertIntoGrid(SpatialGrid& grid, const Scene& scene, int object) {
+    if (grid.ranges.size() < 4 * (object + 1)) {
+        grid.ranges.resize(4 * (object + 1), -1);
+    }
+    float bounds[4];
+    worldBounds(scene, object, bounds);
+    int x0 = gridCell(grid, bounds[0]);
+    int y0 = gridCell(grid, bounds[1]);
+    int x1 = gridCell(grid, bounds[2]);
+    int y1 = gridCell(grid, bounds[3]);
+    if ((x1 - x0 + 1) * (y1 - y0 + 1) > LARGE_OBJECT_CELLS) {
+        grid.large.push_back(object);
+        grid.ranges[4 * object] = -2;
+        return;
+    }
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            grid.cells[cy * grid.size + cx].push_back(object);
+        }
+    }
+    grid.ranges[4 * object] = x0;
+    grid.ranges[4 * object + 1] = y0;
+    grid.ranges[4 * object + 2] = x1;
+    grid.ranges[4 * object + 3] = y1;
+}
+
+void removeFromGrid(SpatialGrid& grid, int object) {
+    if (grid.ranges.size() < 4 * (object + 1) || grid.ranges[4 * object] == -1) {
+        return;
+    }
+    if (grid.ranges[4 * object] == -2) {
+        grid.large.erase(std::find(grid.large.begin(), grid.large.end(), object));
+    }
+    else {
+        for (int cy = grid.ranges[4 * object + 1]; cy <= grid.ranges[4 * object + 3]; ++cy) {
+            for (int cx = grid.ranges[4 * object]; cx <= grid.ranges[4 * object + 2]; ++cx) {
+                std::vector<unsigned int>& cell = grid.cells[cy * grid.size + cx];
+                auto it = std::find(cell.begin(), cell.end(), object);
+                if (it != cell.end()) {
+                    *it = cell.back();
+                    cell.pop_back();
+                }
+            }
+        }
+    }
+    grid.ranges[4 * object] = -1;
+}
+
+void queryGrid(const SpatialGrid& grid, float x, float y, std::vector<unsigned int>& candidates) {
+    const std::vector<unsigned int>& cell = grid.cells[gridCell(grid, y) * grid.size + gridCell(grid, x)];
+    candidates.insert(candidates.end(), cell.begin(), cell.end());
+    candidates.insert(candidates.end(), grid.large.begin(), grid.large.end());
+}
+
+void queryGridWindow(const SpatialGrid& grid, float xMin, float yMin, float xMax, float yMax, std::vector<unsigned int>& candidates) {
+    int x0 = gridCell(grid, xMin), y0 = gridCell(grid, yMin);
+    int x1 = gridCell(grid, xMax), y1 = gridCell(grid, yMax);
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            for (unsigned int object : grid.cells[cy * grid.size + cx]) {
+                // report each object once, from the first of its cells the window covers
+                const int* range = &grid.ranges[4 * object];
+                if (cx == std::max(range[0], x0) && cy == std::max(range[1], y0)) {
+                    candidates.push_back(object);
+                }
+            }
+        }
+    }
+    candidates.insert(candidates.end(), grid.large.begin(), grid.large.end());
+}
+
+void buildEdgeBands(const Scene& scene, int object, EdgeBands& bands) {
+    unsigned int first = scene.offsets[object];
+    unsigned int count = scene.counts[object];
+    int bandCount = std::max(1, std::min((int)count / 4, 4096));
+    bands.minY = scene.minY[object];
+    bands.bandHeight = (scene.maxY[object] - scene.minY[object]) / bandCount;
+    if (bands.bandHeight <= 0.0f) {
+        bandCount = 1;
+        bands.bandHeight = 1.0f;
+    }
+    auto bandOf = [&](float y) {
+        return std::max(0, std::min((int)((y - bands.minY) / bands.bandHeight), bandCount - 1));
+    };
+
+    // counting sort, every edge goes into each band its height range touches,
+    // the band of every vertex is worked out once and shared by the two edges meeting there
+    std::vector<int> vertexBands(count);
+    for (unsigned int k = 0; k < count; ++k) {
+        vertexBands[k] = bandOf(scene.y[first + k]);
+    }
+    bands.firsts.assign(bandCount + 1, 0);
+    for (unsigned int k = 0; k < count; ++k) {
+        int b1 = vertexBands[k], b2 = vertexBands[k + 1 < count ? k + 1 : 0];
+        for (int band = std::min(b1, b2); band <= std::max(b1, b2); ++band) {
+            bands.firsts[band + 1]++;
+        }
+    }
+    for (int band = 0; band < bandCount; ++band) {
+        bands.firsts[band + 1] += bands.firsts[band];
+    }
+    bands.edges.resize(bands.firsts.back());
+    std::vector<unsigned int> fill(bands.firsts.begin(), bands.firsts.end() - 1);
+    for (unsigned int k = 0; k < count; ++k) {
+        int b1 = vertexBands[k], b2 = vertexBands[k + 1 < count ? k + 1 : 0];
+        for (int band = std::min(b1, b2); band <= std::max(b1, b2); ++band) {
+            bands.edges[fill[band]++] = k;
+        }
+    }
+}
+
+bool pointInBands(const Scene& scene, int object, const EdgeBands& bands, float x, float y) {
+    // crossing number test, only against the edges that span the point's band
+    int bandCount = bands.firsts.size() - 1;
+    int band = (int)floor((y - bands.minY) / bands.bandHeight);
+    if (bandCount < 1 || band < 0 || band >= bandCount) {
+        return false;
+    }
+    bool inside = false;
+    unsigned int first = scene.offsets[object];
+    unsigned int count = scene.counts[object];
+    for (unsigned int e = bands.firsts[band]; e < bands.firsts[band + 1]; ++e) {
+        unsigned int k = first + bands.edges[e];
+        unsigned int j = first + (bands.edges[e] + 1) % count;
+        if (((scene.y[k] > y) != (scene.y[j] > y)) &&
+            (x < (scene.x[j] - scene.x[k]) * (y - scene.y[k]) / (scene.y[j] - scene.y[k]) + scene.x[k])) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
@@ -0,0 +1,947 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include "core.h"
+
+// streaming SVG and GeoJSON readers. The file is read a block at a time and parsed as it comes in, every
+// point goes straight into the shape being built, so memory stays bounded whatever the size of the file:
+// one block, one shape and a few batches waiting for the editor. When the file does not state its extent
+// up front it is read twice, once to measure it and once for the shapes.
+//   SVG      <path> d, <polygon> and <polyline> points, and <line>. Closed subpaths and <polygon> become
+//            polygons, the rest lines. Curves and arcs are flattened, transform attributes are ignored.
+//   GeoJSON  LineString, MultiLineString, Polygon and MultiPolygon coordinates, wherever they are nested.
+//            Every ring of a polygon becomes a polygon outline of its own.
+// The extent is fitted into the canvas keeping its aspect ratio, as pixels handed to normalizeCoordinates.
+const unsigned int READ_BLOCK = 1 << 16;
+// batches are handed over once they hold this many vertices, and the reader waits while this many are queued
+const unsigned int BATCH_VERTICES = 1 << 16;
+const unsigned int QUEUED_BATCHES = 8;
+// longer outlines are split into lines that join up, which keeps them drawn but not fillable
+const unsigned int SHAPE_VERTICES = 1 << 20;
+// segments per bezier curve, and the largest angle an arc segment covers in radians
+const int CURVE_SEGMENTS = 8;
+const double ARC_STEP = 0.25;
+// pixels left free around the fitted extent, so outlines along its edges stay visible
+const double FIT_MARGIN = 8.0;
+// deepest nesting of JSON values followed
+const int JSON_DEPTH = 256;
+
+// file read a block at a time, stopping early when the import is cancelled
+struct ImportStream {
+    std::ifstream file;
+    std::vector<char> block;
+    size_t position = 0;
+    size_t size = 0;
+    unsigned long long offset = 0;
+    Importer* importer;
+};
+
+// where parsed points go, either only measured or mapped onto the canvas and queued in batches
+struct ShapeSink {
+    Importer* importer;
+    bool measuring = true;
+    double minX = INFINITY;
+    double minY = INFINITY;
+    double maxX = -INFINITY;
+    double maxY = -INFINITY;
+    // canvas pixels are (x - originX) * scale + offsetX, and the same for y, negated when the file's y goes up
+    unsigned int width;
+    unsigned int height;
+    double originX = 0.0;
+    double originY = 0.0;
+    double scale = 1.0;
+    double offsetX = 0.0;
+    double offsetY = 0.0;
+    bool flipY = false;
+    // shape being built, split is set once part of it was handed over as a line
+    std::vector<float> xs;
+    std::vector<float> ys;
+    bool split = false;
+    float firstX;
+    float firstY;
+    ImportBatch batch;
+    unsigned int batchVertices = 0;
+};
+
+// extent the root <svg> element states, from its viewBox or else its width and height
+struct SvgRoot {
+    bool found = false;
+    double x = 0.0;
+    double y = 0.0;
+    double width = 0.0;
+    double height = 0.0;
+};
+
+bool openStream(ImportStream& stream, const std::string& path, Importer* importer) {
+    stream.file.open(path, std::ios::binary);
+    stream.block.resize(READ_BLOCK);
+    stream.importer = importer;
+    return (bool)stream.file;
+}
+
+int peekChar(ImportStream& stream) {
+    // the next character, or -1 at the end
+    if (stream.position == stream.size) {
+        if (stream.importer->cancelled || !stream.file) {
+            return -1;
+        }
+        stream.offset += stream.size;
+        stream.file.read(stream.block.data(), READ_BLOCK);
+        stream.size = stream.file.gcount();
+        stream.position = 0;
+        if (stream.size == 0) {
+            return -1;
+        }
+    }
+    return (unsigned char)stream.block[stream.position];
+}
+
+int nextChar(ImportStream& stream) {
+    int c = peekChar(stream);
+    if (c != -1) {
+        stream.position++;
+    }
+    return c;
+}
+
+void skipSpaces(ImportStream& stream) {
+    int c;
+    while ((c = peekChar(stream)) != -1 && isspace(c)) {
+        nextChar(stream);
+    }
+}
+
+void skipSeparators(ImportStream& stream) {
+    // whitespace and commas, as between the numbers of SVG path data and points
+    int c;
+    while ((c = peekChar(stream)) != -1 && (isspace(c) || c == ',')) {
+        nextChar(stream);
+    }
+}
+
+bool readNumber(ImportStream& stream, double* value) {
+    // digits are gathered into an integer and a power of ten, a number ends at the first character
+    // that cannot continue it, so "1.5.5" is two of them
+    static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    bool negative = false, digits = false;
+    int c = peekChar(stream);
+    if (c == '+' || c == '-') {
+        negative = c == '-';
+        nextChar(stream);
+        c = peekChar(stream);
+    }
+    // only the first 19 significant digits fit, the rest only move the decimal point
+    unsigned long long mantissa = 0;
+    int significant = 0, exponent = 0;
+    for (bool fraction = false; ; c = peekChar(stream)) {
+        if (c >= '0' && c <= '9') {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (c - '0');
+                significant += mantissa != 0;
+                exponent -= fraction;
+            }
+            else {
+                exponent += !fraction;
+            }
+            digits = true;
+        }
+        else if (c == '.' && !fraction) {
+            fraction = true;
+        }
+        else {
+            break;
+        }
+        nextChar(stream);
+    }
+    if ((c == 'e' || c == 'E') && digits) {
+        nextChar(stream);
+        c = peekChar(stream);
+        bool negativeExponent = c == '-';
+        if (c == '+' || c == '-') {
+            nextChar(stream);
+            c = peekChar(stream);
+        }
+        int power = 0;
+        for (; c >= '0' && c <= '9'; c = peekChar(stream)) {
+            power = std::min(power * 10 + (c - '0'), 9999);
+            nextChar(stream);
+        }
+        exponent += negativeExponent ? -power : power;
+    }
+    double number = (double)mantissa;
+    if (exponent < 0) {
+        number = -exponent <= 22 ? number / POWERS[-exponent] : number * pow(10.0, exponent);
+    }
+    else if (exponent > 0) {
+        number = exponent <= 22 ? number * POWERS[exponent] : number * pow(10.0, exponent);
+    }
+    *value = negative ? -number : number;
+    return digits;
+}
+
+void setExtent(ShapeSink& sink, double x, double y, double width, double height, bool flipY) {
+    // fits the extent into the canvas, centered
+    double scaleX = width > 0.0 ? std::max(1.0, sink.width - 2.0 * FIT_MARGIN) / width : INFINITY;
+    double scaleY = height > 0.0 ? std::max(1.0, sink.height - 2.0 * FIT_MARGIN) / height : INFINITY;
+    sink.scale = std::min(scaleX, scaleY);
+    if (sink.scale == INFINITY) {
+        sink.scale = 1.0;
+    }
+    sink.originX = x;
+    sink.originY = flipY ? y + height : y;
+    sink.offsetX = (sink.width - width * sink.scale) / 2.0;
+    sink.offsetY = (sink.height - height * sink.scale) / 2.0;
+    sink.flipY = flipY;
+    sink.measuring = false;
+}
+
+void flushBatch(ShapeSink& sink) {
+    // waits while the editor is behind, so the queue stays bounded
+    Importer& importer = *sink.importer;
+    if (sink.batch.types.empty()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(importer.mutex);
+    importer.space.wait(lock, [&importer]() { return importer.batches.size() < QUEUED_BATCHES || importer.cancelled; });
+    if (!importer.cancelled) {
+        importer.batches.push_back(std::move(sink.batch));
+        importer.ready.notify_one();
+    }
+    sink.batch = ImportBatch();
+    sink.batchVertices = 0;
+}
+
+void emitShape(ShapeSink& sink, ObjectType type, unsigned int count) {
+    sink.batch.types.push_back(type);
+    sink.batch.counts.push_back(count);
+    sink.batch.x.insert(sink.batch.x.end(), sink.xs.begin(), sink.xs.begin() + count);
+    sink.batch.y.insert(sink.batch.y.end(), sink.ys.begin(), sink.ys.begin() + count);
+    sink.batchVertices += count;
+    if (sink.batchVertices >= BATCH_VERTICES) {
+        flushBatch(sink);
+    }
+}
+
+void addPoint(ShapeSink& sink, double x, double y) {
+    if (sink.measuring) {
+        sink.minX = std::min(sink.minX, x);
+        sink.minY = std::min(sink.minY, y);
+        sink.maxX = std::max(sink.maxX, x);
+        sink.maxY = std::max(sink.maxY, y);
+        return;
+    }
+    float canvasX = (float)((x - sink.originX) * sink.scale + sink.offsetX);
+    float canvasY = (float)((sink.flipY ? sink.originY - y : y - sink.originY) * sink.scale + sink.offsetY);
+    normalizeCoordinates(&canvasX, &canvasY, sink.width, sink.height);
+    if (sink.xs.empty() && !sink.split) {
+        sink.firstX = canvasX;
+        sink.firstY = canvasY;
+    }
+    if (sink.xs.size() == SHAPE_VERTICES) {
+        // too long to keep whole, the part so far goes out as a line and the next one starts where it ended
+        emitShape(sink, ObjectType::line, sink.xs.size());
+        sink.xs.erase(sink.xs.begin(), sink.xs.end() - 1);
+        sink.ys.erase(sink.ys.begin(), sink.ys.end() - 1);
+        sink.split = true;
+    }
+    sink.xs.push_back(canvasX);
+    sink.ys.push_back(canvasY);
+}
+
+void endShape(ShapeSink& sink, bool closed) {
+    if (!sink.measuring) {
+        unsigned int count = sink.xs.size();
+        if (sink.split) {
+            if (closed) {
+                sink.xs.push_back(sink.firstX);
+                sink.ys.push_back(sink.firstY);
+                count++;
+            }
+            if (count >= 2) {
+                emitShape(sink, ObjectType::line, count);
+            }
+        }
+        else if (closed) {
+            // polygons repeat no vertex, they close back to the first one
+            if (count > 1 && sink.xs[count - 1] == sink.xs[0] && sink.ys[count - 1] == sink.ys[0]) {
+                count--;
+            }
+            if (count >= 3) {
+                emitShape(sink, ObjectType::polygon, count);
+            }
+            else if (count == 2) {
+                emitShape(sink, ObjectType::line, count);
+            }
+        }
+        else if (count >= 2) {
+            emitShape(sink, ObjectType::line, count);
+        }
+    }
+    sink.xs.clear();
+    sink.ys.clear();
+    sink.split = false;
+}
+
+void addCubic(ShapeSink& sink, double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3) {
+    for (int k = 1; k <= CURVE_SEGMENTS; ++k) {
+        double t = (double)k / CURVE_SEGMENTS, u = 1.0 - t;
+        addPoint(sink, u * u * u * x0 + 3 * u * u * t * x1 + 3 * u * t * t * x2 + t * t * t * x3,
+            u * u * u * y0 + 3 * u * u * t * y1 + 3 * u * t * t * y2 + t * t * t * y3);
+    }
+}
+
+void addQuadratic(ShapeSink& sink, double x0, double y0, double x1, double y1, double x2, double y2) {
+    for (int k = 1; k <= CURVE_SEGMENTS; ++k) {
+        double t = (double)k / CURVE_SEGMENTS, u = 1.0 - t;
+        addPoint(sink, u * u * x0 + 2 * u * t * x1 + t * t * x2, u * u * y0 + 2 * u * t * y1 + t * t * y2);
+    }
+}
+
+void addArc(ShapeSink& sink, double x1, double y1, double rx, double ry, double angle, bool largeArc, bool sweep, double x2, double y2) {
+    // endpoint to center parameterization, as in the SVG implementation notes
+    if (x1 == x2 && y1 == y2) {
+        return;
+    }
+    rx = fabs(rx);
+    ry = fabs(ry);
+    if (rx == 0.0 || ry == 0.0) {
+        addPoint(sink, x2, y2);
+        return;
+    }
+    double phi = angle * acos(-1.0) / 180.0, cosPhi = cos(phi), sinPhi = sin(phi);
+    double dx = (x1 - x2) / 2.0, dy = (y1 - y2) / 2.0;
+    double x1p = cosPhi * dx + sinPhi * dy, y1p = -sinPhi * dx + cosPhi * dy;
+    // radii too small to reach are scaled up
+    double lambda = (x1p * x1p) / (rx * rx) + (y1p * y1p) / (ry * ry);
+    if (lambda > 1.0) {
+        rx *= sqrt(lambda);
+        ry *= sqrt(lambda);
+    }
+    double numerator = rx * rx * ry * ry - rx * rx * y1p * y1p - ry * ry * x1p * x1p;
+    double denominator = rx * rx * y1p * y1p + ry * ry * x1p * x1p;
+    double coefficient = sqrt(std::max(0.0, numerator / denominator)) * (largeArc == sweep ? -1.0 : 1.0);
+    double cxp = coefficient * rx * y1p / ry, cyp = -coefficient * ry * x1p / rx;
+    double cx = cosPhi * cxp - sinPhi * cyp + (x1 + x2) / 2.0, cy = sinPhi * cxp + cosPhi * cyp + (y1 + y2) / 2.0;
+    auto vectorAngle = [](double ux, double uy, double vx, double vy) {
+        return atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+    };
+    double theta = vectorAngle(1.0, 0.0, (x1p - cxp) / rx, (y1p - cyp) / ry);
+    double delta = vectorAngle((x1p - cxp) / rx, (y1p - cyp) / ry, (-x1p - cxp) / rx, (-y1p - cyp) / ry);
+    if (!sweep && delta > 0.0) {
+        delta -= 2.0 * acos(-1.0);
+    }
+    else if (sweep && delta < 0.0) {
+        delta += 2.0 * acos(-1.0);
+    }
+    int segments = std::max(1, (int)ceil(fabs(delta) / ARC_STEP));
+    for (int k = 1; k < segments; ++k) {
+        double t = theta + delta * k / segments;
+        addPoint(sink, cx + rx * cos(t) * cosPhi - ry * sin(t) * sinPhi, cy + rx * cos(t) * sinPhi + ry * sin(t) * cosPhi);
+    }
+    addPoint(sink, x2, y2);
+}
+
+bool parsePathData(ImportStream& stream, int quote, ShapeSink& sink) {
+    // the d attribute up to its closing quote, every subpath is a shape of its own
+    double x = 0.0, y = 0.0, startX = 0.0, startY = 0.0, controlX = 0.0, controlY = 0.0;
+    int command = 0, previous = 0;
+    bool open = false;
+    while (true) {
+        skipSeparators(stream);
+        int c = peekChar(stream);
+        if (c == -1 || c == quote) {
+            break;
+        }
+        if (isalpha(c)) {
+            command = nextChar(stream);
+            if (command == 'Z' || command == 'z') {
+                if (open) {
+                    endShape(sink, true);
+                    open = false;
+                }
+                x = startX;
+                y = startY;
+                previous = 'Z';
+            }
+            continue;
+        }
+
+        // arguments for the command, repeated commands may leave the letter out
+        int upper = toupper(command);
+        bool relative = command != upper;
+        const char* arguments = strchr("MLT", upper) ? "nn" : strchr("HV", upper) ? "n" : upper == 'C' ? "nnnnnn" :
+            strchr("SQ", upper) ? "nnnn" : upper == 'A' ? "nnnffnn" : NULL;
+        if (arguments == NULL) {
+            return false;
+        }
+        double a[7];
+        for (int k = 0; arguments[k] != '\0'; ++k) {
+            skipSeparators(stream);
+            if (arguments[k] == 'f') {
+                // arc flags are single digits that need no separator
+                int flag = nextChar(stream);
+                if (flag != '0' && flag != '1') {
+                    return false;
+                }
+                a[k] = flag - '0';
+            }
+            else if (!readNumber(stream, &a[k])) {
+                return false;
+            }
+        }
+        double baseX = relative ? x : 0.0, baseY = relative ? y : 0.0;
+        if (upper == 'M') {
+            if (open) {
+                endShape(sink, false);
+            }
+            x = startX = baseX + a[0];
+            y = startY = baseY + a[1];
+            addPoint(sink, x, y);
+            open = true;
+            // pairs after the first one are lines
+            command = relative ? 'l' : 'L';
+            previous = 'M';
+            continue;
+        }
+        if (!open) {
+            // drawing on after a closed subpath starts a new one at its first point
+            addPoint(sink, x, y);
+            open = true;
+        }
+        if (upper == 'L') {
+            x = baseX + a[0];
+            y = baseY + a[1];
+            addPoint(sink, x, y);
+        }
+        else if (upper == 'H') {
+            x = baseX + a[0];
+            addPoint(sink, x, y);
+        }
+        else if (upper == 'V') {
+            y = baseY + a[0];
+            addPoint(sink, x, y);
+        }
+        else if (upper == 'C' || upper == 'S') {
+            double x1, y1;
+            int k = 0;
+            if (upper == 'C') {
+                x1 = baseX + a[0];
+                y1 = baseY + a[1];
+                k = 2;
+            }
+            else {
+                // the first control point mirrors the last one of a previous cubic
+                x1 = previous == 'C' || previous == 'S' ? 2 * x - controlX : x;
+                y1 = previous == 'C' || previous == 'S' ? 2 * y - controlY : y;
+            }
+            controlX = baseX + a[k];
+            controlY = baseY + a[k + 1];
+            double endX = baseX + a[k + 2], endY = baseY + a[k + 3];
+            addCubic(sink, x, y, x1, y1, controlX, controlY, endX, endY);
+            x = endX;
+            y = endY;
+        }
+        else if (upper == 'Q' || upper == 'T') {
+            int k = 0;
+            if (upper == 'Q') {
+                controlX = baseX + a[0];
+                controlY = baseY + a[1];
+                k = 2;
+            }
+            else {
+                controlX = previous == 'Q' || previous == 'T' ? 2 * x - controlX : x;
+                controlY = previous == 'Q' || previous == 'T' ? 2 * y - controlY : y;
+            }
+            double endX = baseX + a[k], endY = baseY + a[k + 1];
+            addQuadratic(sink, x, y, controlX, controlY, endX, endY);
+            x = endX;
+            y = endY;
+        }
+        else if (upper == 'A') {
+            double endX = baseX + a[5], endY = baseY + a[6];
+            addArc(sink, x, y, a[0], a[1], a[2], a[3] != 0.0, a[4] != 0.0, endX, endY);
+            x = endX;
+            y = endY;
+        }
+        previous = upper;
+    }
+    if (open) {
+        endShape(sink, false);
+    }
+    return true;
+}
+
+bool parsePoints(ImportStream& stream, int quote, ShapeSink& sink, bool closed) {
+    // the points attribute of <polygon> and <polyline>, pairs of numbers up to the closing quote
+    while (true) {
+        skipSeparators(stream);
+        int c = peekChar(stream);
+        if (c == -1 || c == quote) {
+            break;
+        }
+        double x, y;
+        if (!readNumber(stream, &x)) {
+            return false;
+        }
+        skipSeparators(stream);
+        if (!readNumber(stream, &y)) {
+            return false;
+        }
+        addPoint(sink, x, y);
+    }
+    endShape(sink, closed);
+    return true;
+}
+
+void readName(ImportStream& stream, std::string& name) {
+    // element and attribute names, only their first 64 characters matter
+    name.clear();
+    int c;
+    while ((c = peekChar(stream)) != -1 && (isalnum(c) || c == '-' || c == '_' || c == ':' || c == '.')) {
+        if (name.size() < 64) {
+            name.push_back((char)c);
+        }
+        nextChar(stream);
+    }
+}
+
+bool skipUntil(ImportStream& stream, const char* end) {
+    // consumes everything up to and including end
+    size_t matched = 0, length = strlen(end);
+    int c;
+    while (matched < length && (c = nextChar(stream)) != -1) {
+        matched = c == end[matched] ? matched + 1 : c == end[0] ? 1 : 0;
+    }
+    return matched == length;
+}
+
+bool parseSvg(ImportStream& stream, ShapeSink& sink, SvgRoot* root) {
+    // with root, only reads up to the <svg> start tag and fills in what it states
+    std::string element, attribute, value;
+    while (true) {
+        if (!skipUntil(stream, "<")) {
+            return true;
+        }
+        int c = peekChar(stream);
+        if (c == '!') {
+            nextChar(stream);
+            bool comment = peekChar(stream) == '-';
+            if (!skipUntil(stream, comment ? "-->" : ">")) {
+                return false;
+            }
+            continue;
+        }
+        if (c == '?' || c == '/') {
+            if (!skipUntil(stream, ">")) {
+                return false;
+            }
+            continue;
+        }
+        readName(stream, element);
+
+        // attributes, the ones that can be long are parsed while they stream in, the rest are kept short
+        double line[4] = { 0.0, 0.0, 0.0, 0.0 };
+        double width = 0.0, height = 0.0;
+        bool viewBox = false;
+        while (true) {
+            skipSpaces(stream);
+            c = peekChar(stream);
+            if (c == -1) {
+                return false;
+            }
+            if (c == '>' || c == '/') {
+                nextChar(stream);
+                if (c == '/' && nextChar(stream) != '>') {
+                    return false;
+                }
+                break;
+            }
+            readName(stream, attribute);
+            if (attribute.empty()) {
+                return false;
+            }
+            skipSpaces(stream);
+            if (nextChar(stream) != '=') {
+                return false;
+            }
+            skipSpaces(stream);
+            int quote = nextChar(stream);
+            if (quote != '"' && quote != '\'') {
+                return false;
+            }
+            if (root == NULL && element == "path" && attribute == "d") {
+                if (!parsePathData(stream, quote, sink)) {
+                    return false;
+                }
+            }
+            else if (root == NULL && (element == "polygon" || element == "polyline") && attribute == "points") {
+                if (!parsePoints(stream, quote, sink, element == "polygon")) {
+                    return false;
+                }
+            }
+            value.clear();
+            while ((c = nextChar(stream)) != -1 && c != quote) {
+                if (value.size() < 256) {
+                    value.push_back((char)c);
+                }
+            }
+            if (c == -1) {
+                return false;
+            }
+            const char* names[] = { "x1", "y1", "x2", "y2" };
+            for (int k = 0; k < 4; ++k) {
+                if (attribute == names[k]) {
+                    line[k] = strtod(value.c_str(), NULL);
+                }
+            }
+            if (attribute == "viewBox") {
+                double box[4];
+                const char* text = value.c_str();
+                char* end;
+                viewBox = true;
+                for (int k = 0; k < 4; ++k) {
+                    box[k] = strtod(text, &end);
+                    viewBox = viewBox && end != text;
+                    text = end + strspn(end, " ,\t\r\n");
+                }
+                if (viewBox && root != NULL) {
+                    root->x = box[0];
+                    root->y = box[1];
+                    root->width = box[2];
+                    root->height = box[3];
+                }
+            }
+            // percentages say nothing about the extent
+            else if ((attribute == "width" || attribute == "height") && value.find('%') == std::string::npos) {
+                (attribute == "width" ? width : height) = strtod(value.c_str(), NULL);
+            }
+        }
+
+        if (element == "svg" && root != NULL) {
+            if (!viewBox && width > 0.0 && height > 0.0) {
+                root->width = width;
+                root->height = height;
+            }
+            root->found = root->width > 0.0 && root->height > 0.0;
+            return true;
+        }
+        if (element == "line" && root == NULL) {
+            addPoint(sink, line[0], line[1]);
+            addPoint(sink, line[2], line[3]);
+            endShape(sink, false);
+        }
+    }
+}
+
+bool readString(ImportStream& stream, std::string& text) {
+    // the rest of a JSON string whose opening quote was read, keeping its first 64 characters
+    text.clear();
+    int c;
+    while ((c = nextChar(stream)) != -1 && c != '"') {
+        if (c == '\\') {
+            c = nextChar(stream);
+        }
+        if (text.size() < 64) {
+            text.push_back((char)c);
+        }
+    }
+    return c == '"';
+}
+
+bool parseCoordinates(ImportStream& stream, ShapeSink& sink, const std::string& type) {
+    // positions are the innermost arrays, the arrays right around them are the lines and rings. Without
+    // a type yet, rings nested three deep are polygons when they close, and four deep always are
+    skipSpaces(stream);
+    int positionLevel = 0;
+    while (peekChar(stream) == '[') {
+        nextChar(stream);
+        positionLevel++;
+        skipSpaces(stream);
+    }
+    int shapeLevel = positionLevel - 1;
+    bool known = !type.empty();
+    bool lines = type == "LineString" || type == "MultiLineString";
+    bool polygons = type == "Polygon" || type == "MultiPolygon";
+    bool points = positionLevel < 2 || (known && !lines && !polygons);
+
+    int level = positionLevel, coordinate = 0, count = 0;
+    double position[2] = { 0.0, 0.0 }, first[2] = { 0.0, 0.0 }, last[2] = { 0.0, 0.0 };
+    while (level > 0) {
+        skipSpaces(stream);
+        int c = peekChar(stream);
+        if (c == '[') {
+            nextChar(stream);
+            level++;
+            coordinate = 0;
+        }
+        else if (c == ']') {
+            nextChar(stream);
+            if (level == shapeLevel && !points) {
+                bool closed = count >= 4 && first[0] == last[0] && first[1] == last[1];
+                endShape(sink, known ? polygons : shapeLevel >= 3 || (shapeLevel == 2 && closed));
+                count = 0;
+            }
+            level--;
+            coordinate = 0;
+        }
+        else if (c == ',') {
+            nextChar(stream);
+        }
+        else {
+            double value;
+            if (!readNumber(stream, &value)) {
+                return false;
+            }
+            // heights and anything after them are left out
+            if (level == positionLevel && coordinate < 2) {
+                position[coordinate++] = value;
+                if (coordinate == 2 && !points) {
+                    if (count++ == 0) {
+                        first[0] = position[0];
+                        first[1] = position[1];
+                    }
+                    last[0] = position[0];
+                    last[1] = position[1];
+                    addPoint(sink, position[0], position[1]);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool parseJson(ImportStream& stream, ShapeSink& sink, int depth) {
+    // one value, objects are searched for coordinates and skipped otherwise
+    if (depth > JSON_DEPTH) {
+        return false;
+    }
+    skipSpaces(stream);
+    int c = nextChar(stream);
+    std::string text;
+    if (c == '{') {
+        // the type of this object, when it came before its coordinates
+        std::string type, key;
+        skipSpaces(stream);
+        if (peekChar(stream) == '}') {
+            nextChar(stream);
+            return true;
+        }
+        while (true) {
+            skipSpaces(stream);
+            if (nextChar(stream) != '"' || !readString(stream, key)) {
+                return false;
+            }
+            skipSpaces(stream);
+            if (nextChar(stream) != ':') {
+                return false;
+            }
+            skipSpaces(stream);
+            if (key == "coordinates" && peekChar(stream) == '[') {
+                if (!parseCoordinates(stream, sink, type)) {
+                    return false;
+                }
+            }
+            else if (key == "type" && peekChar(stream) == '"') {
+                nextChar(stream);
+                if (!readString(stream, type)) {
+                    return false;
+                }
+            }
+            else if (!parseJson(stream, sink, depth + 1)) {
+                return false;
+            }
+            skipSpaces(stream);
+            c = nextChar(stream);
+            if (c == '}') {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+    if (c == '[') {
+        skipSpaces(stream);
+        if (peekChar(stream) == ']') {
+            nextChar(stream);
+            return true;
+        }
+        while (true) {
+            if (!parseJson(stream, sink, depth + 1)) {
+                return false;
+            }
+            skipSpaces(stream);
+            c = nextChar(stream);
+            if (c == ']') {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+    if (c == '"') {
+        return readString(stream, text);
+    }
+    if (c == '-' || isdigit(c)) {
+        // the first character is already taken, the rest of the number is read on
+        double value;
+        stream.position--;
+        return readNumber(stream, &value);
+    }
+    if (c == 't' || c == 'f' || c == 'n') {
+        readName(stream, text);
+        return true;
+    }
+    return false;
+}
+
+void runImport(Importer* importer, std::string path, unsigned int width, unsigned int height, bool svg) {
+    ShapeSink sink;
+    sink.importer = importer;
+    sink.width = width;
+    sink.height = height;
+
+    // the extent comes first, from the root element of an SVG when it has one or else from a pass measuring every point
+    SvgRoot root;
+    if (svg) {
+        ImportStream stream;
+        if (openStream(stream, path, importer)) {
+            parseSvg(stream, sink, &root);
+        }
+    }
+    // shapes before anything malformed are kept, both passes stop at the same place
+    bool valid = true;
+    unsigned long long stoppedAt = 0;
+    for (int pass = root.found ? 1 : 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            if (root.found) {
+                setExtent(sink, root.x, root.y, root.width, root.height, false);
+            }
+            else if (sink.minX <= sink.maxX) {
+                setExtent(sink, sink.minX, sink.minY, sink.maxX - sink.minX, sink.maxY - sink.minY, !svg);
+            }
+            else {
+                break;
+            }
+        }
+        ImportStream stream;
+        if (openStream(stream, path, importer) && !(svg ? parseSvg(stream, sink, NULL) : parseJson(stream, sink, 0))) {
+            valid = false;
+            stoppedAt = stream.offset + stream.position;
+        }
+    }
+    flushBatch(sink);
+    if (!valid && !importer->cancelled) {
+        std::cout << path << " is malformed, reading stopped at byte " << stoppedAt << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(importer->mutex);
+    importer->finished = true;
+    importer->ready.notify_all();
+}
+
+bool startImport(Importer& importer, const char* path, unsigned int width, unsigned int height) {
+    // the format follows the extension, or else the first character
+    stopImport(importer);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    std::string name = path;
+    std::string extension = name.substr(std::min(name.size(), name.rfind('.') + 1));
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    bool svg;
+    if (extension == "svg") {
+        svg = true;
+    }
+    else if (extension == "json" || extension == "geojson") {
+        svg = false;
+    }
+    else {
+        char c = ' ';
+        while (file.get(c) && isspace((unsigned char)c)) {
+        }
+        if (c != '<' && c != '{') {
+            std::cout << path << " is neither SVG nor GeoJSON" << std::endl;
+            return false;
+        }
+        svg = c == '<';
+    }
+    importer.finished = false;
+    importer.cancelled = false;
+    importer.thread = std::thread(runImport, &importer, name, width, height, svg);
+    return true;
+}
+
+bool takeImportBatch(Importer& importer, ImportBatch& batch) {
+    // false when no batch is waiting
+    std::lock_guard<std::mutex> lock(importer.mutex);
+    if (importer.batches.empty()) {
+        return false;
+    }
+    batch = std::move(importer.batches.front());
+    importer.batches.pop_front();
+    importer.space.notify_one();
+    return true;
+}
+
+bool waitImportBatch(Importer& importer, ImportBatch& batch) {
+    // blocks until a batch is waiting, false once the file is read and every batch taken
+    if (!importer.thread.joinable()) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(importer.mutex);
+    importer.ready.wait(lock, [&importer]() { return !importer.batches.empty() || importer.finished; });
+    if (importer.batches.empty()) {
+        return false;
+    }
+    batch = std::move(importer.batches.front());
+    importer.batches.pop_front();
+    importer.space.notify_one();
+    return true;
+}
+
+bool importRunning(Importer& importer) {
+    // true until the file is read and every batch taken
+    if (!importer.thread.joinable()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(importer.mutex);
+    return !importer.finished || !importer.batches.empty();
+}
+
+void stopImport(Importer& importer) {
+    // cancels what is left and waits for the reader
+    if (importer.thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(importer.mutex);
+            importer.cancelled = true;
+        }
+        importer.space.notify_all();
+        importer.thread.join();
+    }
+    importer.batches.clear();
+    importer.finished = true;
+}
+
+void appendImportBatch(Document& document, const ImportBatch& batch) {
+    // every shape becomes a finished object, there must be no open one
+    Scene& scene = document.scene;
+    unsigned int firstVertex = scene.x.size(), firstObject = scene.ids.size();
+    unsigned int vertex = 0;
+    for (unsigned int k = 0; k < batch.types.size(); ++k) {
+        addObject(scene, batch.types[k]);
+        for (unsigned int j = vertex; j < vertex + batch.counts[k]; ++j) {
+            appendVertex(scene, batch.x[j], batch.y[j]);
+        }
+        vertex += batch.counts[k];
+        indexObject(document, scene.ids.size() - 1);
+    }
+    markDirty(document.sceneDirty, firstVertex, vertex);
+    markDirty(document.transformDirty, firstObject, batch.types.size());
+}
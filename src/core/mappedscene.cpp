@@ -0,0 +1,328 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "core.h"
+
+// uncompressed scene file that is mapped instead of read. A header gives the counts and where every
+// section starts, each section is page aligned and holds one table exactly as it is in memory:
+// the vertex columns and transform texels as the GPU buffers hold them, the object tables as the
+// Scene vectors hold them, the polygon every fill copies in the order of the fills, and the
+// triangulations as a polygon id, an index count and the indices. Values are in the byte order of
+// the machine that wrote them, a file from the other order is refused.
+const char MAPPED_MAGIC[4] = { 'C', 'G', 'S', 'M' };
+const unsigned int MAPPED_VERSION = 1;
+const unsigned int MAPPED_BYTE_ORDER = 0x01020304;
+const unsigned int MAPPED_ALIGNMENT = 4096;
+// transforms are turned into texels this many objects at a time
+const unsigned int TEXEL_BLOCK = 4096;
+
+enum MappedSection : unsigned int {
+    mappedX,
+    mappedY,
+    mappedObjects,
+    mappedTexels,
+    mappedIds,
+    mappedTypes,
+    mappedOffsets,
+    mappedCounts,
+    mappedMinX,
+    mappedMinY,
+    mappedMaxX,
+    mappedMaxY,
+    mappedTransforms,
+    mappedSources,
+    mappedTriangulations,
+    MAPPED_SECTIONS
+};
+
+struct MappedHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int byteOrder;
+    unsigned int objectCount;
+    unsigned int vertexCount;
+    unsigned int nextId;
+    // offset and size in bytes of every section
+    unsigned long long sections[MAPPED_SECTIONS][2];
+};
+
+void writeSection(std::ofstream& file, MappedHeader& header, unsigned int section, const void* data, unsigned long long size) {
+    // pads up to the next page, so the section can be used straight from the mapping
+    unsigned long long offset = file.tellp();
+    unsigned long long padding = (MAPPED_ALIGNMENT - offset % MAPPED_ALIGNMENT) % MAPPED_ALIGNMENT;
+    static const char zeros[MAPPED_ALIGNMENT] = {};
+    file.write(zeros, padding);
+    header.sections[section][0] = offset + padding;
+    header.sections[section][1] = size;
+    if (size > 0) {
+        file.write((const char*)data, size);
+    }
+}
+
+template <typename T>
+void copySection(const MappedScene& mapped, unsigned int section, std::vector<T>& values) {
+    const MappedHeader* header = (const MappedHeader*)mapped.data;
+    values.resize(header->sections[section][1] / sizeof(T));
+    if (!values.empty()) {
+        memcpy(values.data(), mapped.data + header->sections[section][0], header->sections[section][1]);
+    }
+}
+
+template <typename T>
+const T* sectionValues(const MappedScene& mapped, unsigned int section, size_t* count) {
+    // the section read in place, every one starts page aligned
+    const MappedHeader* header = (const MappedHeader*)mapped.data;
+    *count = header->sections[section][1] / sizeof(T);
+    return (const T*)(mapped.data + header->sections[section][0]);
+}
+
+bool saveMappedScene(const Document& document, const char* path) {
+    // everything but a line or polygon still being drawn, which is always the last object
+    const Scene& scene = document.scene;
+    unsigned int objectCount = document.openObject == -1 ? scene.ids.size() : document.openObject;
+    unsigned int vertexCount = objectCount < scene.ids.size() ? scene.offsets[objectCount] : scene.x.size();
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    // the header is written again once every section is in place
+    MappedHeader header = {};
+    memcpy(header.magic, MAPPED_MAGIC, 4);
+    header.version = MAPPED_VERSION;
+    header.byteOrder = MAPPED_BYTE_ORDER;
+    header.objectCount = objectCount;
+    header.vertexCount = vertexCount;
+    header.nextId = scene.nextId;
+    file.write((const char*)&header, sizeof(header));
+
+    writeSection(file, header, mappedX, scene.x.data(), sizeof(float) * vertexCount);
+    writeSection(file, header, mappedY, scene.y.data(), sizeof(float) * vertexCount);
+    writeSection(file, header, mappedObjects, scene.objects.data(), sizeof(unsigned int) * vertexCount);
+
+    // single precision rows padded to four floats, as uploadTransforms sends them
+    writeSection(file, header, mappedTexels, NULL, 0);
+    header.sections[mappedTexels][1] = sizeof(float) * 8 * (unsigned long long)objectCount;
+    std::vector<float> texels;
+    for (unsigned int begin = 0; begin < objectCount; begin += TEXEL_BLOCK) {
+        unsigned int end = std::min(objectCount, begin + TEXEL_BLOCK);
+        texels.assign(8 * (end - begin), 0.0f);
+        for (unsigned int i = begin; i < end; ++i) {
+            const double* m = &scene.transforms[6 * i];
+            for (int k = 0; k < 3; ++k) {
+                texels[8 * (i - begin) + k] = (float)m[k];
+                texels[8 * (i - begin) + 4 + k] = (float)m[3 + k];
+            }
+        }
+        file.write((const char*)texels.data(), sizeof(float) * texels.size());
+    }
+
+    writeSection(file, header, mappedIds, scene.ids.data(), sizeof(unsigned int) * objectCount);
+    writeSection(file, header, mappedTypes, scene.types.data(), sizeof(ObjectType) * objectCount);
+    writeSection(file, header, mappedOffsets, scene.offsets.data(), sizeof(unsigned int) * objectCount);
+    writeSection(file, header, mappedCounts, scene.counts.data(), sizeof(unsigned int) * objectCount);
+    writeSection(file, header, mappedMinX, scene.minX.data(), sizeof(float) * objectCount);
+    writeSection(file, header, mappedMinY, scene.minY.data(), sizeof(float) * objectCount);
+    writeSection(file, header, mappedMaxX, scene.maxX.data(), sizeof(float) * objectCount);
+    writeSection(file, header, mappedMaxY, scene.maxY.data(), sizeof(float) * objectCount);
+    writeSection(file, header, mappedTransforms, scene.transforms.data(), sizeof(double) * 6 * objectCount);
+
+    std::vector<unsigned int> words;
+    for (unsigned int i = 0; i < objectCount; ++i) {
+        if (scene.types[i] == ObjectType::fill) {
+            auto source = document.fillSources.find(scene.ids[i]);
+            words.push_back(source != document.fillSources.end() ? source->second : scene.ids[i]);
+        }
+    }
+    writeSection(file, header, mappedSources, words.data(), sizeof(unsigned int) * words.size());
+
+    // only the triangulations of polygons that are saved
+    words.clear();
+    for (auto& triangulation : document.triangulations) {
+        if (findObject(scene, triangulation.first) >= (int)objectCount) {
+            continue;
+        }
+        words.push_back(triangulation.first);
+        words.push_back(triangulation.second.size());
+        words.insert(words.end(), triangulation.second.begin(), triangulation.second.end());
+    }
+    writeSection(file, header, mappedTriangulations, words.data(), sizeof(unsigned int) * words.size());
+
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(header));
+    if (!file) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool isMappedScene(const char* path) {
+    char magic[4];
+    std::ifstream file(path, std::ios::binary);
+    return file.read(magic, 4) && memcmp(magic, MAPPED_MAGIC, 4) == 0;
+}
+
+bool openMappedScene(MappedScene& mapped, const char* path) {
+    // the whole file is mapped read only, and read ahead since all of it is about to be used
+    mapped = MappedScene();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping != NULL) {
+        mapped.data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        mapped.size = size.QuadPart;
+        // the view keeps the file open
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int file = open(path, O_RDONLY);
+    if (file == -1) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;
+#endif
+        void* data = mmap(NULL, info.st_size, PROT_READ, flags, file, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            mapped.data = (const unsigned char*)data;
+            mapped.size = info.st_size;
+        }
+    }
+    close(file);
+#endif
+    if (mapped.data == NULL) {
+        std::cout << "Failed to map " << path << std::endl;
+        mapped = MappedScene();
+        return false;
+    }
+
+    // every section must lie inside the file and match the counts, nothing past the header is read yet
+    const MappedHeader* header = (const MappedHeader*)mapped.data;
+    if (mapped.size < sizeof(MappedHeader) || memcmp(header->magic, MAPPED_MAGIC, 4) != 0) {
+        std::cout << path << " is not a mapped scene file" << std::endl;
+        closeMappedScene(mapped);
+        return false;
+    }
+    if (header->version != MAPPED_VERSION || header->byteOrder != MAPPED_BYTE_ORDER) {
+        std::cout << path << " has unsupported version " << header->version << " or byte order" << std::endl;
+        closeMappedScene(mapped);
+        return false;
+    }
+    unsigned long long objects = header->objectCount, vertices = header->vertexCount;
+    unsigned long long expected[MAPPED_SECTIONS] = {
+        4 * vertices, 4 * vertices, 4 * vertices, 32 * objects,
+        4 * objects, sizeof(ObjectType) * objects, 4 * objects, 4 * objects,
+        4 * objects, 4 * objects, 4 * objects, 4 * objects, 48 * objects, 0, 0
+    };
+    bool valid = true;
+    for (unsigned int section = 0; section < MAPPED_SECTIONS; ++section) {
+        unsigned long long offset = header->sections[section][0], size = header->sections[section][1];
+        valid = valid && offset % MAPPED_ALIGNMENT == 0 && offset <= mapped.size && size <= mapped.size - offset &&
+            size % 4 == 0 && (section >= mappedSources || size == expected[section]);
+    }
+    if (!valid) {
+        std::cout << path << " is damaged" << std::endl;
+        closeMappedScene(mapped);
+        return false;
+    }
+    mapped.objectCount = header->objectCount;
+    mapped.vertexCount = header->vertexCount;
+    mapped.x = (const float*)(mapped.data + header->sections[mappedX][0]);
+    mapped.y = (const float*)(mapped.data + header->sections[mappedY][0]);
+    mapped.objects = (const unsigned int*)(mapped.data + header->sections[mappedObjects][0]);
+    mapped.texels = (const float*)(mapped.data + header->sections[mappedTexels][0]);
+    return true;
+}
+
+void closeMappedScene(MappedScene& mapped) {
+    if (mapped.data != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapped.data);
+#else
+        munmap((void*)mapped.data, mapped.size);
+#endif
+    }
+    mapped = MappedScene();
+}
+
+bool loadMappedScene(Document& document, ThreadPool& pool, const MappedScene& mapped, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons) {
+    // replaces the document with copies of the mapped tables, nothing is decoded per vertex
+
+    // the tables must agree before anything is derived from them, objects are checked but vertices are not,
+    // and all of it is checked in the mapping so a damaged file leaves the document as it was
+    const MappedHeader* header = (const MappedHeader*)mapped.data;
+    size_t count, fillSources, wordCount;
+    const unsigned int* ids = sectionValues<unsigned int>(mapped, mappedIds, &count);
+    const ObjectType* types = sectionValues<ObjectType>(mapped, mappedTypes, &count);
+    const unsigned int* offsets = sectionValues<unsigned int>(mapped, mappedOffsets, &count);
+    const unsigned int* counts = sectionValues<unsigned int>(mapped, mappedCounts, &count);
+    sectionValues<unsigned int>(mapped, mappedSources, &fillSources);
+    const unsigned int* words = sectionValues<unsigned int>(mapped, mappedTriangulations, &wordCount);
+    unsigned long long offset = 0;
+    unsigned int fillCount = 0;
+    bool valid = true;
+    for (unsigned int i = 0; i < mapped.objectCount && valid; ++i) {
+        valid = offsets[i] == offset && types[i] <= ObjectType::fill && (i == 0 || ids[i] > ids[i - 1]);
+        offset += counts[i];
+        fillCount += types[i] == ObjectType::fill;
+    }
+    // new objects must not reuse an id
+    valid = valid && offset == mapped.vertexCount && fillSources == fillCount &&
+        (mapped.objectCount == 0 || header->nextId > ids[mapped.objectCount - 1]);
+    for (size_t position = 0; valid && position < wordCount;) {
+        valid = wordCount - position >= 2 && words[position + 1] <= wordCount - position - 2;
+        position += valid ? 2 + words[position + 1] : 0;
+    }
+    if (!valid) {
+        std::cout << "Mapped scene is damaged" << std::endl;
+        return false;
+    }
+
+    clearDocument(document);
+    Scene& scene = document.scene;
+    copySection(mapped, mappedX, scene.x);
+    copySection(mapped, mappedY, scene.y);
+    copySection(mapped, mappedObjects, scene.objects);
+    copySection(mapped, mappedIds, scene.ids);
+    copySection(mapped, mappedTypes, scene.types);
+    copySection(mapped, mappedOffsets, scene.offsets);
+    copySection(mapped, mappedCounts, scene.counts);
+    copySection(mapped, mappedMinX, scene.minX);
+    copySection(mapped, mappedMinY, scene.minY);
+    copySection(mapped, mappedMaxX, scene.maxX);
+    copySection(mapped, mappedMaxY, scene.maxY);
+    copySection(mapped, mappedTransforms, scene.transforms);
+    scene.nextId = header->nextId;
+    std::vector<unsigned int> sources;
+    copySection(mapped, mappedSources, sources);
+    for (size_t position = 0; position < wordCount; position += 2 + words[position + 1]) {
+        document.triangulations[words[position]].assign(words + position + 2, words + position + 2 + words[position + 1]);
+    }
+    indexLoadedScene(document, pool, sources, fills, polygons);
+    return true;
+}
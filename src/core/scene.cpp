@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <math.h>
+#include "core.h"
+
+unsigned int addObject(Scene& scene, ObjectType type) {
+    unsigned int id = scene.nextId++;
+    scene.ids.push_back(id);
+    scene.types.push_back(type);
+    scene.offsets.push_back(scene.x.size());
+    scene.counts.push_back(0);
+    scene.minX.push_back(INFINITY);
+    scene.minY.push_back(INFINITY);
+    scene.maxX.push_back(-INFINITY);
+    scene.maxY.push_back(-INFINITY);
+    // identity
+    scene.transforms.insert(scene.transforms.end(), { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 });
+    return id;
+}
+
+void appendVertex(Scene& scene, float x, float y) {
+    // vertices always belong to the most recently added object
+    scene.x.push_back(x);
+    scene.y.push_back(y);
+    scene.objects.push_back(scene.ids.size() - 1);
+    scene.counts.back()++;
+    scene.minX.back() = std::min(scene.minX.back(), x);
+    scene.minY.back() = std::min(scene.minY.back(), y);
+    scene.maxX.back() = std::max(scene.maxX.back(), x);
+    scene.maxY.back() = std::max(scene.maxY.back(), y);
+}
+
+void popObject(Scene& scene) {
+    scene.x.resize(scene.offsets.back());
+    scene.y.resize(scene.offsets.back());
+    scene.objects.resize(scene.offsets.back());
+    scene.ids.pop_back();
+    scene.types.pop_back();
+    scene.offsets.pop_back();
+    scene.counts.pop_back();
+    scene.minX.pop_back();
+    scene.minY.pop_back();
+    scene.maxX.pop_back();
+    scene.maxY.pop_back();
+    scene.transforms.resize(scene.transforms.size() - 6);
+}
+
+void clearScene(Scene& scene) {
+    scene.x.clear();
+    scene.y.clear();
+    scene.objects.clear();
+    scene.ids.clear();
+    scene.types.clear();
+    scene.offsets.clear();
+    scene.counts.clear();
+    scene.minX.clear();
+    scene.minY.clear();
+    scene.maxX.clear();
+    scene.maxY.clear();
+    scene.transforms.clear();
+    scene.nextId = 0;
+}
+
+void updateBounds(Scene& scene, int object) {
+    unsigned int first = scene.offsets[object];
+    unsigned int last = first + scene.counts[object];
+    scene.minX[object] = scene.minY[object] = INFINITY;
+    scene.maxX[object] = scene.maxY[object] = -INFINITY;
+    for (unsigned int j = first; j < last; ++j) {
+        scene.minX[object] = std::min(scene.minX[object], scene.x[j]);
+        scene.minY[object] = std::min(scene.minY[object], scene.y[j]);
+        scene.maxX[object] = std::max(scene.maxX[object], scene.x[j]);
+        scene.maxY[object] = std::max(scene.maxY[object], scene.y[j]);
+    }
+}
+
+void worldBounds(const Scene& scene, int object, float* bounds) {
+    // box around the transformed corners of the local box, exact unless rotated or sheared
+    const double* m = &scene.transforms[6 * object];
+    double xs[2] = { scene.minX[object], scene.maxX[object] };
+    double ys[2] = { scene.minY[object], scene.maxY[object] };
+    bounds[0] = bounds[1] = INFINITY;
+    bounds[2] = bounds[3] = -INFINITY;
+    for (double x : xs) {
+        for (double y : ys) {
+            float worldX = (float)(m[0] * x + m[1] * y + m[2]);
+            float worldY = (float)(m[3] * x + m[4] * y + m[5]);
+            bounds[0] = std::min(bounds[0], worldX);
+            bounds[1] = std::min(bounds[1], worldY);
+            bounds[2] = std::max(bounds[2], worldX);
+            bounds[3] = std::max(bounds[3], worldY);
+        }
+    }
+}
+
+void composeTransform(Scene& scene, int object, const double* op) {
+    // applies op after the object's current transform
+    double* m = &scene.transforms[6 * object];
+    double result[6] = {
+        op[0] * m[0] + op[1] * m[3], op[0] * m[1] + op[1] * m[4], op[0] * m[2] + op[1] * m[5] + op[2],
+        op[3] * m[0] + op[4] * m[3], op[3] * m[1] + op[4] * m[4], op[3] * m[2] + op[4] * m[5] + op[5]
+    };
+    std::copy(result, result + 6, m);
+}
+
+bool invertTransform(const Scene& scene, int object, float x, float y, float* localX, float* localY) {
+    const double* m = &scene.transforms[6 * object];
+    double determinant = m[0] * m[4] - m[1] * m[3];
+    if (determinant == 0.0) {
+        // scaled flat, nothing is inside
+        return false;
+    }
+    double dx = x - m[2];
+    double dy = y - m[5];
+    *localX = (float)((m[4] * dx - m[1] * dy) / determinant);
+    *localY = (float)((m[0] * dy - m[3] * dx) / determinant);
+    return true;
+}
+
+bool isIdentity(const Scene& scene, int object) {
+    const double* m = &scene.transforms[6 * object];
+    return m[0] == 1.0 && m[1] == 0.0 && m[2] == 0.0 && m[3] == 0.0 && m[4] == 1.0 && m[5] == 0.0;
+}
+
+void bakeTransform(Scene& scene, int object) {
+    // one pass over the vertices, however many operations were composed
+    double* m = &scene.transforms[6 * object];
+    float single[6] = { (float)m[0], (float)m[1], (float)m[2], (float)m[3], (float)m[4], (float)m[5] };
+    unsigned int first = scene.offsets[object];
+    transformKernel(single)(single, &scene.x[first], &scene.y[first], &scene.x[first], &scene.y[first], scene.counts[object]);
+    m[0] = m[4] = 1.0;
+    m[1] = m[2] = m[3] = m[5] = 0.0;
+    updateBounds(scene, object);
+}
+
+int findObject(const Scene& scene, unsigned int id) {
+    // ids only ever grow, so the table stays sorted
+    auto it = std::lower_bound(scene.ids.begin(), scene.ids.end(), id);
+    if (it == scene.ids.end() || *it != id) {
+        return -1;
+    }
+    return it - scene.ids.begin();
+}
+
+bool pointInObject(const Scene& scene, int object, float x, float y) {
+    // crossing number test against the closed outline
+    bool inside = false;
+    unsigned int first = scene.offsets[object];
+    unsigned int last = first + scene.counts[object];
+    for (unsigned int k = first, j = last - 1; k < last; j = k++) {
+        if (((scene.y[k] > y) != (scene.y[j] > y)) &&
+            (x < (scene.x[j] - scene.x[k]) * (y - scene.y[k]) / (scene.y[j] - scene.y[k]) + scene.x[k])) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+void markDirty(DirtyRanges& dirty, unsigned int offset, unsigned int count) {
+    if (count > 0) {
+        dirty.offsets.push_back(offset);
+        dirty.counts.push_back(count);
+    }
+}
+
+void coalesceDirty(DirtyRanges& dirty, unsigned int gap) {
+    std::vector<unsigned int> order(dirty.offsets.size());
+    for (int i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&dirty](unsigned int a, unsigned int b) {
+        return dirty.offsets[a] < dirty.offsets[b];
+    });
+
+    // merge ranges that overlap or sit closer than gap, one upload beats two small ones
+    std::vector<unsigned int> offsets, counts;
+    for (unsigned int i : order) {
+        unsigned int offset = dirty.offsets[i];
+        unsigned int end = offset + dirty.counts[i];
+        if (!offsets.empty() && offset <= offsets.back() + counts.back() + gap) {
+            counts.back() = std::max(offsets.back() + counts.back(), end) - offsets.back();
+        }
+        else {
+            offsets.push_back(offset);
+            counts.push_back(end - offset);
+        }
+    }
+    dirty.offsets.swap(offsets);
+    dirty.counts.swap(counts);
+}
+
+bool objectInWindow(const Scene& scene, int object, float xMin, float yMin, float xMax, float yMax, std::vector<float>& worldXs, std::vector<float>& worldYs) {
+    float bounds[4];
+    worldBounds(scene, object, bounds);
+    if (bounds[0] > xMax || bounds[2] < xMin || bounds[1] > yMax || bounds[3] < yMin) {
+        return false;
+    }
+    if (bounds[0] >= xMin && bounds[2] <= xMax && bounds[1] >= yMin && bounds[3] <= yMax) {
+        return true;
+    }
+    const double* m = &scene.transforms[6 * object];
+    if (m[1] == 0.0 && m[3] == 0.0) {
+        // axis aligned, the box is exact
+        return false;
+    }
+
+    // rotated or sheared boxes are loose, only the vertices themselves can tell
+    float single[6] = { (float)m[0], (float)m[1], (float)m[2], (float)m[3], (float)m[4], (float)m[5] };
+    unsigned int first = scene.offsets[object];
+    unsigned int count = scene.counts[object];
+    worldXs.resize(count);
+    worldYs.resize(count);
+    transformKernel(single)(single, &scene.x[first], &scene.y[first], worldXs.data(), worldYs.data(), count);
+    for (unsigned int j = 0; j < count; ++j) {
+        if (worldXs[j] < xMin || worldXs[j] > xMax || worldYs[j] < yMin || worldYs[j] > yMax) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool closesPolygon(const Scene& scene, int object, float x, float y) {
+    unsigned int first = scene.offsets[object];
+    return scene.counts[object] > 1 && fabs(x - scene.x[first]) < 0.05f && fabs(y - scene.y[first]) < 0.05f;
+}
+
+void normalizeCoordinates(float* x, float* y, unsigned int width, unsigned int height) {
+    *x = (2.0f / (float)width) * *x - 1;
+    // flip Y coordinate
+    *y = -((2.0f / (float)height) * *y - 1);
+}
@@ -0,0 +1,466 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+#include "core.h"
+
+// file layout: "CGSC" and a 4 byte version, then chunks, each a 4 byte tag, its stored and raw sizes
+// as 4 byte values and the zlib stream, or the raw bytes when both sizes are equal, all little endian.
+// The chunks are
+//   HEAD  object count, vertex count and next id as varints, the quantization step as a float,
+//         then how many objects and vertices a full OBJS and VERT chunk holds as varints
+//   OBJS  a run of objects, each its type byte, id and vertex count as varints, the id of the polygon
+//         a fill copies, and a byte saying whether six doubles of transform follow
+//   VERT  a run of vertices, their count, then x and y as zigzag varints of the change from the
+//         previous quantized value, starting from 0 in every chunk
+//   TRIS  triangulations, a polygon id, an index count and the indices as varints
+// HEAD comes first, objects and vertices come in order and only the last OBJS and VERT chunks may be
+// short, so every chunk can be decoded on its own as soon as it is read and where its vertices go is
+// known from its position. Unknown chunks are skipped. Ids strictly increase and the next id is above
+// all of them. The counts in HEAD are not trusted for allocating, the columns only grow with the chunks
+// that are read, which is why full chunks may hold at most OBJECT_CHUNK objects and VERTEX_CHUNK vertices.
+const char SCENE_MAGIC[4] = { 'C', 'G', 'S', 'C' };
+const unsigned int SCENE_VERSION = 1;
+// coordinates are stored as multiples of 2^-22, a few float steps at the edge of the canvas,
+// and clamped to +-256 so the change between two of them fits in 32 bits
+const float SCENE_STEP = 1.0f / 4194304.0f;
+const double SCENE_LIMIT = 1073741823.0;
+const unsigned int OBJECT_CHUNK = 1 << 16;
+const unsigned int VERTEX_CHUNK = 1 << 18;
+const unsigned int TRIANGULATION_CHUNK = 1 << 20;
+// vertex chunks compressed or decompressed at once, bounding the memory held besides the scene
+const unsigned int CHUNK_BATCH = 32;
+
+// a chunk as it is in the file
+struct PackedChunk {
+    char tag[4];
+    unsigned int rawSize;
+    std::vector<unsigned char> data;
+};
+
+void writeUint32(std::ostream& file, unsigned int value) {
+    unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+    file.write((const char*)bytes, 4);
+}
+
+bool readUint32(std::istream& file, unsigned int* value) {
+    unsigned char bytes[4];
+    if (!file.read((char*)bytes, 4)) {
+        return false;
+    }
+    *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+    return true;
+}
+
+void packChunk(const char* tag, const std::vector<unsigned char>& raw, PackedChunk& chunk) {
+    // the fastest level, deltas of smooth outlines compress well enough and saving stays quick
+    uLongf size = compressBound(raw.size());
+    memcpy(chunk.tag, tag, 4);
+    chunk.rawSize = raw.size();
+    chunk.data.resize(size);
+    compress2(chunk.data.data(), &size, raw.data(), raw.size(), Z_BEST_SPEED);
+    // scattered coordinates hardly compress, and inflating them would cost more than reading what it saves
+    if (size >= raw.size() - raw.size() / 8) {
+        chunk.data.assign(raw.begin(), raw.end());
+    }
+    else {
+        chunk.data.resize(size);
+    }
+}
+
+bool unpackChunk(PackedChunk& chunk, std::vector<unsigned char>& raw) {
+    // the chunk's bytes are taken over when they are stored raw
+    if (chunk.data.size() == chunk.rawSize) {
+        raw.swap(chunk.data);
+        return true;
+    }
+    uLongf size = chunk.rawSize;
+    raw.resize(chunk.rawSize);
+    return uncompress(raw.data(), &size, chunk.data.data(), chunk.data.size()) == Z_OK && size == chunk.rawSize;
+}
+
+void writeChunk(std::ostream& file, const PackedChunk& chunk) {
+    file.write(chunk.tag, 4);
+    writeUint32(file, chunk.data.size());
+    writeUint32(file, chunk.rawSize);
+    file.write((const char*)chunk.data.data(), chunk.data.size());
+}
+
+// 1 for a chunk, 0 at the end of the file, -1 when it is cut short
+int readChunk(std::istream& file, PackedChunk& chunk) {
+    if (!file.read(chunk.tag, 4)) {
+        return 0;
+    }
+    unsigned int size;
+    if (!readUint32(file, &size) || !readUint32(file, &chunk.rawSize)) {
+        return -1;
+    }
+    chunk.data.resize(size);
+    return file.read((char*)chunk.data.data(), size) ? 1 : -1;
+}
+
+void encodeColumn(const float* values, unsigned int count, std::vector<unsigned char>& raw) {
+    // at most 5 bytes a value, written in place instead of through writeVarint, this runs for every vertex
+    size_t position = raw.size();
+    raw.resize(position + 5 * (size_t)count);
+    unsigned char* out = raw.data() + position;
+    int previous = 0;
+    for (unsigned int j = 0; j < count; ++j) {
+        int value = (int)lrint(std::max(-SCENE_LIMIT, std::min(SCENE_LIMIT, (double)values[j] / SCENE_STEP)));
+        unsigned int delta = zigzag(value - previous);
+        previous = value;
+        while (delta >= 0x80) {
+            *out++ = (unsigned char)(delta | 0x80);
+            delta >>= 7;
+        }
+        *out++ = (unsigned char)delta;
+    }
+    raw.resize(out - raw.data());
+}
+
+template <typename T>
+void growColumn(std::vector<T>& column, unsigned long long size, unsigned long long limit) {
+    // doubles the capacity, but never past what the file says it holds
+    if (size > column.capacity()) {
+        column.reserve(std::min(limit, std::max(size, 2 * (unsigned long long)column.capacity())));
+    }
+}
+
+bool decodeColumn(const std::vector<unsigned char>& raw, size_t& position, float step, unsigned int count, float* values) {
+    const unsigned char* in = raw.data() + position;
+    const unsigned char* end = raw.data() + raw.size();
+    int previous = 0;
+    for (unsigned int j = 0; j < count; ++j) {
+        unsigned int delta = 0;
+        for (int shift = 0;; shift += 7) {
+            if (in == end || shift > 28) {
+                return false;
+            }
+            unsigned char byte = *in++;
+            delta |= (unsigned int)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        previous += unzigzag(delta);
+        values[j] = previous * step;
+    }
+    position = in - raw.data();
+    return true;
+}
+
+void indexLoadedScene(Document& document, ThreadPool& pool, const std::vector<unsigned int>& sources,
+    std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons) {
+    // what indexObject does for every object, with the edge bands built in parallel and only the grid filled in order,
+    // then every fill is matched with the polygon it copies, sources holds their ids in the order of the fills
+    Scene& scene = document.scene;
+    unsigned int objectCount = scene.ids.size();
+    std::vector<EdgeBands> bands(objectCount);
+    parallelFor(pool, objectCount, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            if (scene.types[i] == ObjectType::polygon) {
+                buildEdgeBands(scene, i, bands[i]);
+            }
+        }
+    });
+    for (unsigned int i = 0; i < objectCount; ++i) {
+        insertIntoGrid(document.grid, scene, i);
+        if (scene.types[i] == ObjectType::polygon) {
+            document.edgeBands.emplace_hint(document.edgeBands.end(), i, std::move(bands[i]));
+        }
+    }
+    markDirty(document.sceneDirty, 0, scene.x.size());
+    markDirty(document.transformDirty, 0, objectCount);
+
+    unsigned int fill = 0;
+    for (unsigned int i = 0; i < objectCount; ++i) {
+        if (scene.types[i] != ObjectType::fill) {
+            continue;
+        }
+        int polygon = findObject(scene, sources[fill++]);
+        auto triangles = polygon == -1 ? document.triangulations.end() : document.triangulations.find(scene.ids[polygon]);
+        if (triangles == document.triangulations.end() || scene.counts[polygon] != scene.counts[i] ||
+            std::any_of(triangles->second.begin(), triangles->second.end(), [&](unsigned int index) { return index >= scene.counts[i]; })) {
+            // nothing to draw it with, the outline is still there
+            continue;
+        }
+        document.fillSources[scene.ids[i]] = scene.ids[polygon];
+        fills.push_back(i);
+        polygons.push_back(polygon);
+    }
+}
+
+bool saveScene(const Document& document, ThreadPool& pool, const char* path) {
+    // everything but a line or polygon still being drawn, which is always the last object
+    const Scene& scene = document.scene;
+    unsigned int objectCount = document.openObject == -1 ? scene.ids.size() : document.openObject;
+    unsigned int vertexCount = objectCount < scene.ids.size() ? scene.offsets[objectCount] : scene.x.size();
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    file.write(SCENE_MAGIC, 4);
+    writeUint32(file, SCENE_VERSION);
+
+    std::vector<unsigned char> raw;
+    PackedChunk chunk;
+    writeVarint(raw, objectCount);
+    writeVarint(raw, vertexCount);
+    writeVarint(raw, scene.nextId);
+    writeFloat(raw, SCENE_STEP);
+    writeVarint(raw, OBJECT_CHUNK);
+    writeVarint(raw, VERTEX_CHUNK);
+    packChunk("HEAD", raw, chunk);
+    writeChunk(file, chunk);
+
+    for (unsigned int begin = 0; begin < objectCount; begin += OBJECT_CHUNK) {
+        unsigned int end = std::min(objectCount, begin + OBJECT_CHUNK);
+        raw.clear();
+        for (unsigned int i = begin; i < end; ++i) {
+            raw.push_back((unsigned char)scene.types[i]);
+            writeVarint(raw, scene.ids[i]);
+            writeVarint(raw, scene.counts[i]);
+            if (scene.types[i] == ObjectType::fill) {
+                auto source = document.fillSources.find(scene.ids[i]);
+                writeVarint(raw, source != document.fillSources.end() ? source->second : scene.ids[i]);
+            }
+            if (isIdentity(scene, i)) {
+                raw.push_back(0);
+            }
+            else {
+                raw.push_back(1);
+                for (int k = 0; k < 6; ++k) {
+                    writeDouble(raw, scene.transforms[6 * i + k]);
+                }
+            }
+        }
+        packChunk("OBJS", raw, chunk);
+        writeChunk(file, chunk);
+    }
+
+    // vertex chunks are independent, a batch of them is encoded and compressed in parallel and written in order
+    unsigned int chunkCount = (vertexCount + VERTEX_CHUNK - 1) / VERTEX_CHUNK;
+    std::vector<PackedChunk> batch(std::min(chunkCount, CHUNK_BATCH));
+    for (unsigned int first = 0; first < chunkCount; first += CHUNK_BATCH) {
+        unsigned int count = std::min(chunkCount - first, CHUNK_BATCH);
+        parallelFor(pool, count, [&](unsigned int begin, unsigned int end) {
+            std::vector<unsigned char> vertices;
+            for (unsigned int k = begin; k < end; ++k) {
+                unsigned int offset = (first + k) * VERTEX_CHUNK;
+                unsigned int size = std::min(vertexCount - offset, VERTEX_CHUNK);
+                vertices.clear();
+                writeVarint(vertices, size);
+                encodeColumn(&scene.x[offset], size, vertices);
+                encodeColumn(&scene.y[offset], size, vertices);
+                packChunk("VERT", vertices, batch[k]);
+            }
+        });
+        for (unsigned int k = 0; k < count; ++k) {
+            writeChunk(file, batch[k]);
+        }
+    }
+
+    // only the triangulations of polygons that are saved
+    raw.clear();
+    for (auto& triangulation : document.triangulations) {
+        if (findObject(scene, triangulation.first) >= (int)objectCount) {
+            continue;
+        }
+        writeVarint(raw, triangulation.first);
+        writeVarint(raw, triangulation.second.size());
+        for (unsigned int index : triangulation.second) {
+            writeVarint(raw, index);
+        }
+        if (raw.size() >= TRIANGULATION_CHUNK) {
+            packChunk("TRIS", raw, chunk);
+            writeChunk(file, chunk);
+            raw.clear();
+        }
+    }
+    if (!raw.empty()) {
+        packChunk("TRIS", raw, chunk);
+        writeChunk(file, chunk);
+    }
+
+    if (!file) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadScene(Document& document, ThreadPool& pool, const char* path, std::vector<unsigned int>& fills, std::vector<unsigned int>& polygons) {
+    // replaces the document, reporting every fill with the polygon it copies like floodFill does,
+    // the file is read into a document of its own so one that cannot be read leaves this one as it was
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    char magic[4];
+    unsigned int version = 0;
+    if (!file.read(magic, 4) || memcmp(magic, SCENE_MAGIC, 4) != 0 || !readUint32(file, &version)) {
+        std::cout << path << " is not a scene file" << std::endl;
+        return false;
+    }
+    if (version != SCENE_VERSION) {
+        std::cout << path << " has unsupported version " << version << std::endl;
+        return false;
+    }
+
+    Document loaded;
+    initDocument(loaded, document.grid.size);
+    Scene& scene = loaded.scene;
+    unsigned long long objectCount = 0, vertexCount = 0, nextId = 0, objectChunk = 0, vertexChunk = 0;
+    float step = SCENE_STEP;
+    bool headRead = false;
+    std::vector<unsigned int> sources;
+    std::vector<unsigned char> raw;
+    // vertex chunks read since the last batch was decoded, and how many came before them
+    std::vector<PackedChunk> batch(CHUNK_BATCH);
+    unsigned int batchSize = 0, chunksDecoded = 0;
+    std::vector<char> decoded(CHUNK_BATCH);
+    int status;
+    bool valid = true;
+    auto decodeBatch = [&]() {
+        // every chunk knows where its vertices go, so a batch of them is decompressed and decoded in parallel,
+        // the columns grow to hold the batch first
+        unsigned long long size = std::min(vertexCount, (unsigned long long)(chunksDecoded + batchSize) * vertexChunk);
+        growColumn(scene.x, size, vertexCount);
+        growColumn(scene.y, size, vertexCount);
+        scene.x.resize(size);
+        scene.y.resize(size);
+        parallelFor(pool, batchSize, [&](unsigned int begin, unsigned int end) {
+            std::vector<unsigned char> vertices;
+            for (unsigned int k = begin; k < end; ++k) {
+                unsigned long long offset = (unsigned long long)(chunksDecoded + k) * vertexChunk;
+                unsigned long long size = 0;
+                size_t position = 0;
+                decoded[k] = offset < vertexCount && unpackChunk(batch[k], vertices) && readVarint(vertices, position, &size) &&
+                    size == std::min(vertexCount - offset, vertexChunk) &&
+                    decodeColumn(vertices, position, step, size, &scene.x[offset]) &&
+                    decodeColumn(vertices, position, step, size, &scene.y[offset]);
+            }
+        });
+        for (unsigned int k = 0; k < batchSize; ++k) {
+            valid = valid && decoded[k];
+        }
+        chunksDecoded += batchSize;
+        batchSize = 0;
+    };
+    while (valid && (status = readChunk(file, batch[batchSize])) == 1) {
+        PackedChunk& chunk = batch[batchSize];
+        size_t position = 0;
+        if (memcmp(chunk.tag, "VERT", 4) == 0) {
+            valid = headRead;
+            if (valid && ++batchSize == CHUNK_BATCH) {
+                decodeBatch();
+            }
+            continue;
+        }
+        if (!unpackChunk(chunk, raw)) {
+            valid = false;
+        }
+        else if (memcmp(chunk.tag, "HEAD", 4) == 0) {
+            valid = !headRead && readVarint(raw, position, &objectCount) && readVarint(raw, position, &vertexCount) &&
+                readVarint(raw, position, &nextId) && readFloat(raw, position, &step) &&
+                readVarint(raw, position, &objectChunk) && readVarint(raw, position, &vertexChunk) &&
+                objectCount <= 0xffffffffull && vertexCount <= 0xffffffffull && nextId <= 0xffffffffull &&
+                objectChunk > 0 && objectChunk <= OBJECT_CHUNK && vertexChunk > 0 && vertexChunk <= VERTEX_CHUNK;
+            headRead = valid;
+        }
+        else if (memcmp(chunk.tag, "OBJS", 4) == 0) {
+            unsigned long long size = std::min(objectCount, scene.ids.size() + objectChunk);
+            growColumn(scene.ids, size, objectCount);
+            growColumn(scene.types, size, objectCount);
+            growColumn(scene.counts, size, objectCount);
+            growColumn(scene.transforms, 6 * size, 6 * objectCount);
+            valid = headRead;
+            while (valid && position < raw.size()) {
+                unsigned char type = raw[position++];
+                unsigned long long id, count, source = 0;
+                valid = type <= (unsigned char)ObjectType::fill && readVarint(raw, position, &id) && readVarint(raw, position, &count);
+                if (valid && type == (unsigned char)ObjectType::fill) {
+                    valid = readVarint(raw, position, &source);
+                    sources.push_back((unsigned int)source);
+                }
+                // ids strictly increase, findObject searches them
+                valid = valid && position < raw.size() && scene.ids.size() < objectCount && id <= 0xffffffffull &&
+                    (scene.ids.empty() || id > scene.ids.back());
+                if (!valid) {
+                    break;
+                }
+                scene.ids.push_back((unsigned int)id);
+                scene.types.push_back((ObjectType)type);
+                scene.counts.push_back((unsigned int)count);
+                if (raw[position++] == 0) {
+                    scene.transforms.insert(scene.transforms.end(), { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 });
+                }
+                else {
+                    for (int k = 0; k < 6 && valid; ++k) {
+                        double value;
+                        valid = readDouble(raw, position, &value);
+                        scene.transforms.push_back(value);
+                    }
+                }
+            }
+        }
+        else if (memcmp(chunk.tag, "TRIS", 4) == 0) {
+            while (valid && position < raw.size()) {
+                unsigned long long id, count;
+                valid = readVarint(raw, position, &id) && readVarint(raw, position, &count) && count <= raw.size() - position;
+                std::vector<unsigned int> triangles(valid ? count : 0);
+                for (unsigned long long k = 0; k < count && valid; ++k) {
+                    unsigned long long index;
+                    valid = readVarint(raw, position, &index);
+                    triangles[k] = (unsigned int)index;
+                }
+                if (valid) {
+                    loaded.triangulations[(unsigned int)id].swap(triangles);
+                }
+            }
+        }
+    }
+    if (valid && batchSize > 0) {
+        decodeBatch();
+    }
+
+    // the tables must agree before anything is derived from them
+    unsigned long long total = 0;
+    for (unsigned int count : scene.counts) {
+        total += count;
+    }
+    // and new objects must not reuse an id
+    if (!valid || status == -1 || !headRead || scene.ids.size() != objectCount || total != vertexCount ||
+        scene.x.size() != vertexCount || (objectCount > 0 && nextId <= scene.ids.back())) {
+        std::cout << path << " is damaged" << std::endl;
+        return false;
+    }
+
+    // offsets, bounds and the vertex to object column follow from the counts
+    scene.nextId = (unsigned int)nextId;
+    scene.offsets.resize(objectCount);
+    scene.minX.resize(objectCount);
+    scene.minY.resize(objectCount);
+    scene.maxX.resize(objectCount);
+    scene.maxY.resize(objectCount);
+    scene.objects.resize(vertexCount);
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < objectCount; ++i) {
+        scene.offsets[i] = offset;
+        offset += scene.counts[i];
+    }
+
+    parallelFor(pool, objectCount, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            std::fill(scene.objects.begin() + scene.offsets[i], scene.objects.begin() + scene.offsets[i] + scene.counts[i], i);
+            updateBounds(scene, i);
+        }
+    });
+    indexLoadedScene(loaded, pool, sources, fills, polygons);
+    document = std::move(loaded);
+    return true;
+}
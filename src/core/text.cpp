@@ -0,0 +1,34 @@
+#include "core.h"
+
+void layoutText(const std::map<char, Glyph>& glyphs, const std::string& text, float x, float y, float scale, const float* color,
+    unsigned int width, unsigned int height, std::vector<float>& vertices) {
+    // appends two triangles per glyph, x, y, u, v, r, g, b per vertex, with the pen position given in normalized coordinates
+    x *= width;
+    y *= height;
+
+    for (char c : text) {
+        auto found = glyphs.find(c);
+        if (found == glyphs.end()) {
+            continue;
+        }
+        const Glyph& ch = found->second;
+
+        float xpos = x + ch.bearing[0] * scale;
+        float ypos = y - (ch.size[1] - ch.bearing[1]) * scale;
+        float w = ch.size[0] * scale;
+        float h = ch.size[1] * scale;
+
+        float quad[6][7] = {
+            { xpos / width,       (ypos + h) / height, ch.uvMin[0], ch.uvMin[1], color[0], color[1], color[2] },
+            { xpos / width,       ypos / height,       ch.uvMin[0], ch.uvMax[1], color[0], color[1], color[2] },
+            { (xpos + w) / width, ypos / height,       ch.uvMax[0], ch.uvMax[1], color[0], color[1], color[2] },
+
+            { xpos / width,       (ypos + h) / height, ch.uvMin[0], ch.uvMin[1], color[0], color[1], color[2] },
+            { (xpos + w) / width, ypos / height,       ch.uvMax[0], ch.uvMax[1], color[0], color[1], color[2] },
+            { (xpos + w) / width, (ypos + h) / height, ch.uvMax[0], ch.uvMin[1], color[0], color[1], color[2] }
+        };
+        vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 6 * 7);
+        // advance is in 1/64 pixels
+        x += (ch.advance >> 6) * scale;
+    }
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include "core.h"
+
+void startThreadPool(ThreadPool& pool, unsigned int threads) {
+    // the calling thread works too
+    for (unsigned int t = 1; t < threads; ++t) {
+        pool.workers.push_back(std::thread([&pool]() {
+            unsigned int seen = 0;
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            while (true) {
+                pool.wake.wait(lock, [&]() { return pool.stopping || pool.generation != seen; });
+                if (pool.stopping) {
+                    return;
+                }
+                seen = pool.generation;
+                pool.busy++;
+                lock.unlock();
+                runChunks(pool);
+                lock.lock();
+                if (--pool.busy == 0) {
+                    pool.finished.notify_all();
+                }
+            }
+        }));
+    }
+}
+
+void stopThreadPool(ThreadPool& pool) {
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.stopping = true;
+    }
+    pool.wake.notify_all();
+    for (std::thread& worker : pool.workers) {
+        worker.join();
+    }
+    pool.workers.clear();
+}
+
+void runChunks(ThreadPool& pool) {
+    while (true) {
+        unsigned int begin = pool.next.fetch_add(pool.chunk);
+        if (begin >= pool.count) {
+            return;
+        }
+        pool.job(begin, std::min(begin + pool.chunk, pool.count));
+    }
+}
+
+void parallelFor(ThreadPool& pool, unsigned int count, const std::function<void(unsigned int, unsigned int)>& job) {
+    if (pool.workers.empty() || count < 2) {
+        job(0, count);
+        return;
+    }
+    {
+        // a worker that woke up late for the previous loop must leave it before the job is replaced
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.finished.wait(lock, [&pool]() { return pool.busy == 0; });
+        pool.job = job;
+        pool.count = count;
+        // several chunks per thread, object sizes vary a lot
+        pool.chunk = std::max(1u, count / (8 * ((unsigned int)pool.workers.size() + 1)));
+        pool.next = 0;
+        pool.generation++;
+    }
+    pool.wake.notify_all();
+    runChunks(pool);
+    std::unique_lock<std::mutex> lock(pool.mutex);
+    pool.finished.wait(lock, [&pool]() { return pool.busy == 0; });
+}
@@ -0,0 +1,347 @@
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <math.h>
+#include "core.h"
+
+bool triangulatePolygon(const float* xs, const float* ys, unsigned int count, std::vector<unsigned int>& triangles) {
+    // drop repeated points, zero length edges have no direction to classify
+    std::vector<unsigned int> vertices;
+    for (unsigned int i = 0; i < count; ++i) {
+        if (vertices.empty() || xs[i] != xs[vertices.back()] || ys[i] != ys[vertices.back()]) {
+            vertices.push_back(i);
+        }
+    }
+    while (vertices.size() > 1 && xs[vertices.back()] == xs[vertices[0]] && ys[vertices.back()] == ys[vertices[0]]) {
+        vertices.pop_back();
+    }
+    int n = vertices.size();
+    if (n < 3) {
+        return false;
+    }
+
+    // work counter-clockwise in double precision
+    double area = 0.0;
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        area += (double)xs[vertices[j]] * ys[vertices[i]] - (double)xs[vertices[i]] * ys[vertices[j]];
+    }
+    if (area == 0.0) {
+        return false;
+    }
+    if (area < 0.0) {
+        std::reverse(vertices.begin(), vertices.end());
+    }
+    std::vector<double> px(n), py(n);
+    for (int i = 0; i < n; ++i) {
+        px[i] = xs[vertices[i]];
+        py[i] = ys[vertices[i]];
+    }
+    auto below = [&](int a, int b) {
+        return py[a] < py[b] || (py[a] == py[b] && px[a] > px[b]);
+    };
+    auto cross = [&](int a, int b, int c) {
+        return (px[b] - px[a]) * (py[c] - py[b]) - (py[b] - py[a]) * (px[c] - px[b]);
+    };
+    auto prev = [n](int i) { return (i + n - 1) % n; };
+    auto next = [n](int i) { return (i + 1) % n; };
+
+    // classify vertices for the sweep
+    enum class VertexType { start, end, split, merge, regular };
+    std::vector<VertexType> types(n);
+    for (int i = 0; i < n; ++i) {
+        bool convex = cross(prev(i), i, next(i)) > 0.0;
+        if (below(prev(i), i) && below(next(i), i)) {
+            types[i] = convex ? VertexType::start : VertexType::split;
+        }
+        else if (below(i, prev(i)) && below(i, next(i))) {
+            types[i] = convex ? VertexType::end : VertexType::merge;
+        }
+        else {
+            types[i] = VertexType::regular;
+        }
+    }
+    std::vector<int> events(n);
+    for (int i = 0; i < n; ++i) {
+        events[i] = i;
+    }
+    std::sort(events.begin(), events.end(), [&](int a, int b) { return below(b, a); });
+
+    // sweep status holds the edges with the interior to their right, ordered by x at the sweep line,
+    // edge i runs from vertex i to vertex i + 1 and -1 stands for the point being looked up
+    double sweepY = 0.0, queryX = 0.0;
+    auto edgeX = [&](int e) {
+        if (e == -1) {
+            return queryX;
+        }
+        int a = e, b = next(e);
+        if (py[a] == py[b]) {
+            return std::max(px[a], px[b]);
+        }
+        if (sweepY == py[a]) {
+            return px[a];
+        }
+        if (sweepY == py[b]) {
+            return px[b];
+        }
+        return px[a] + (sweepY - py[a]) * (px[b] - px[a]) / (py[b] - py[a]);
+    };
+    auto edgeOrder = [&](int a, int b) {
+        double xa = edgeX(a), xb = edgeX(b);
+        if (xa != xb) {
+            return xa < xb;
+        }
+        return a < b;
+    };
+    std::set<int, decltype(edgeOrder)> status(edgeOrder);
+    std::vector<std::set<int, decltype(edgeOrder)>::iterator> positions(n, status.end());
+    std::vector<int> helpers(n, -1);
+    std::vector<int> diagonals;
+    auto addDiagonal = [&](int a, int b) {
+        diagonals.push_back(a);
+        diagonals.push_back(b);
+    };
+    auto insertEdge = [&](int e, int helper) {
+        positions[e] = status.insert(e).first;
+        helpers[e] = helper;
+    };
+    auto removeEdge = [&](int e) {
+        if (positions[e] == status.end()) {
+            return false;
+        }
+        status.erase(positions[e]);
+        positions[e] = status.end();
+        return true;
+    };
+    auto leftEdge = [&](int v) {
+        queryX = px[v];
+        auto it = status.lower_bound(-1);
+        if (it == status.begin()) {
+            return -1;
+        }
+        return *--it;
+    };
+
+    // split into y-monotone pieces
+    for (int v : events) {
+        sweepY = py[v];
+        int e = prev(v);
+        int left;
+        switch (types[v]) {
+        case VertexType::start:
+            insertEdge(v, v);
+            break;
+        case VertexType::end:
+            if (helpers[e] == -1) {
+                return false;
+            }
+            if (types[helpers[e]] == VertexType::merge) {
+                addDiagonal(v, helpers[e]);
+            }
+            if (!removeEdge(e)) {
+                return false;
+            }
+            break;
+        case VertexType::split:
+            left = leftEdge(v);
+            if (left == -1) {
+                return false;
+            }
+            addDiagonal(v, helpers[left]);
+            helpers[left] = v;
+            insertEdge(v, v);
+            break;
+        case VertexType::merge:
+            if (helpers[e] == -1) {
+                return false;
+            }
+            if (types[helpers[e]] == VertexType::merge) {
+                addDiagonal(v, helpers[e]);
+            }
+            if (!removeEdge(e)) {
+                return false;
+            }
+            left = leftEdge(v);
+            if (left == -1) {
+                return false;
+            }
+            if (types[helpers[left]] == VertexType::merge) {
+                addDiagonal(v, helpers[left]);
+            }
+            helpers[left] = v;
+            break;
+        case VertexType::regular:
+            if (below(next(v), v)) {
+                // on the left boundary, the interior lies to the right
+                if (helpers[e] == -1) {
+                    return false;
+                }
+                if (types[helpers[e]] == VertexType::merge) {
+                    addDiagonal(v, helpers[e]);
+                }
+                if (!removeEdge(e)) {
+                    return false;
+                }
+                insertEdge(v, v);
+            }
+            else {
+                left = leftEdge(v);
+                if (left == -1) {
+                    return false;
+                }
+                if (types[helpers[left]] == VertexType::merge) {
+                    addDiagonal(v, helpers[left]);
+                }
+                helpers[left] = v;
+            }
+            break;
+        }
+    }
+
+    // half-edges grouped by origin and sorted by angle, so the pieces can be walked face by face
+    struct HalfEdge {
+        int from;
+        double angle;
+        int to;
+    };
+    std::vector<HalfEdge> halfEdges;
+    auto addHalfEdges = [&](int a, int b) {
+        halfEdges.push_back({ a, atan2(py[b] - py[a], px[b] - px[a]), b });
+        halfEdges.push_back({ b, atan2(py[a] - py[b], px[a] - px[b]), a });
+    };
+    for (int i = 0; i < n; ++i) {
+        addHalfEdges(i, next(i));
+    }
+    for (int i = 0; i < diagonals.size(); i += 2) {
+        addHalfEdges(diagonals[i], diagonals[i + 1]);
+    }
+    std::sort(halfEdges.begin(), halfEdges.end(), [](const HalfEdge& a, const HalfEdge& b) {
+        return a.from < b.from || (a.from == b.from && a.angle < b.angle);
+    });
+    std::vector<int> firstEdges(n + 1, 0);
+    for (const HalfEdge& h : halfEdges) {
+        firstEdges[h.from + 1]++;
+    }
+    for (int v = 0; v < n; ++v) {
+        firstEdges[v + 1] += firstEdges[v];
+    }
+    std::vector<char> visited(halfEdges.size(), 0);
+    auto twin = [&](int h) {
+        // the half-edge going back, found by its angle around the far vertex
+        int v = halfEdges[h].to, u = halfEdges[h].from;
+        double angle = atan2(py[u] - py[v], px[u] - px[v]);
+        auto begin = halfEdges.begin() + firstEdges[v], end = halfEdges.begin() + firstEdges[v + 1];
+        auto it = std::lower_bound(begin, end, angle, [](const HalfEdge& e, double a) { return e.angle < a; });
+        while (it != end && it->to != u) {
+            ++it;
+        }
+        return it == end ? -1 : (int)(it - halfEdges.begin());
+    };
+
+    std::vector<unsigned int> result;
+    std::vector<int> face, chain, order, stack;
+    for (int start = 0; start < halfEdges.size(); ++start) {
+        // polygon edges only bound the interior going forward, diagonals bound it both ways
+        if (visited[start] || halfEdges[start].to == prev(halfEdges[start].from)) {
+            continue;
+        }
+
+        // walk the face, always taking the next half-edge clockwise
+        face.clear();
+        int h = start;
+        while (!visited[h]) {
+            if (face.size() > n) {
+                return false;
+            }
+            visited[h] = true;
+            face.push_back(halfEdges[h].from);
+            int back = twin(h);
+            if (back == -1) {
+                return false;
+            }
+            int v = halfEdges[h].to;
+            h = back == firstEdges[v] ? firstEdges[v + 1] - 1 : back - 1;
+        }
+        int m = face.size();
+        if (m < 3) {
+            return false;
+        }
+
+        // left chain runs forward from the top to the bottom of the piece
+        int top = 0, bottom = 0;
+        for (int i = 1; i < m; ++i) {
+            if (below(face[top], face[i])) {
+                top = i;
+            }
+            if (below(face[i], face[bottom])) {
+                bottom = i;
+            }
+        }
+        chain.assign(m, 1);
+        for (int i = top; i != bottom; i = (i + 1) % m) {
+            chain[i] = 0;
+        }
+        chain[bottom] = 0;
+        order.resize(m);
+        for (int i = 0; i < m; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return below(face[b], face[a]); });
+
+        // triangulate the monotone piece with a stack of reflex vertices
+        auto emit = [&](int a, int b, int c) {
+            result.push_back(face[a]);
+            result.push_back(face[b]);
+            result.push_back(face[c]);
+        };
+        stack.clear();
+        stack.push_back(order[0]);
+        stack.push_back(order[1]);
+        for (int j = 2; j < m - 1; ++j) {
+            int current = order[j];
+            if (chain[current] != chain[stack.back()]) {
+                for (int s = 1; s < stack.size(); ++s) {
+                    emit(current, stack[s - 1], stack[s]);
+                }
+                int last = stack.back();
+                stack.clear();
+                stack.push_back(last);
+                stack.push_back(current);
+            }
+            else {
+                int last = stack.back();
+                stack.pop_back();
+                while (!stack.empty()) {
+                    double turn = chain[current] == 0
+                        ? cross(face[stack.back()], face[last], face[current])
+                        : cross(face[current], face[last], face[stack.back()]);
+                    if (turn <= 0.0) {
+                        break;
+                    }
+                    emit(current, last, stack.back());
+                    last = stack.back();
+                    stack.pop_back();
+                }
+                stack.push_back(last);
+                stack.push_back(current);
+            }
+        }
+        for (int s = 1; s < stack.size(); ++s) {
+            emit(order[m - 1], stack[s - 1], stack[s]);
+        }
+    }
+
+    // self-intersecting outlines sweep into pieces that do not add up to the polygon
+    double covered = 0.0;
+    for (int i = 0; i < result.size(); i += 3) {
+        covered += fabs(cross(result[i], result[i + 1], result[i + 2]));
+    }
+    if (result.size() != 3 * (n - 2) || fabs(covered - fabs(area)) > 1e-6 * fabs(area)) {
+        return false;
+    }
+
+    triangles.clear();
+    for (unsigned int index : result) {
+        triangles.push_back(vertices[index]);
+    }
+    return true;
+}
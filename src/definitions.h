@@ -9,35 +9,92 @@ enum class DrawMode : unsigned int {
     floodFill
 };
 
-enum class Transformation : unsigned int {
-    none,
-    translation,
-    scaling,
-    rotation,
-    reflectionX,
-    reflectionY,
-    reflectionOrigin,
-    shearX,
-    shearY
+// multi-draw ranges for one primitive type
+struct DrawList {
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+};
+
+// fill triangles, bump allocated from one growable index buffer, fills are never removed on their own
+// so nothing is freed until the scene is cleared, which resets the arena and keeps the buffer for the next one
+struct FillArena {
+    unsigned int buffer = 0;
+    unsigned int capacity = 0;
+    // first index that was never handed out
+    unsigned int top = 0;
+    // one entry per fill, laid out for glMultiDrawElements
+    std::vector<unsigned int> objects;
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    // entry of every fill, by id
+    std::map<unsigned int, unsigned int> entries;
+};
+
+// parts of a frame the hud times on the GPU
+enum class Pass : unsigned int {
+    scene,
+    fills,
+    text,
+    ui
 };
 
-struct Character {
-    GLuint textureID;
-    glm::ivec2 size;
-    glm::ivec2 bearing;
-    GLuint advance;
+// GL_TIME_ELAPSED queries for the last few frames, results are read once the slot comes around again
+// so the CPU never waits for the frame it just submitted, a pass may be split into several sections
+const int TIMER_FRAMES = 4;
+const int TIMER_SECTIONS = 8;
+struct FrameTimer {
+    unsigned int queries[TIMER_FRAMES][TIMER_SECTIONS];
+    Pass passes[TIMER_FRAMES][TIMER_SECTIONS];
+    int sections[TIMER_FRAMES];
+    int frame;
+    // section whose query is running, -1 when there is none
+    int open;
+    // milliseconds per pass of the newest frame with results
+    double gpu[4];
 };
 
 // function declarations
+int runHeadless(int frames, const char* output);
+void initRenderer();
+void renderFrame();
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+void windowRefreshCallback(GLFWwindow* window);
 void processKeyboardInput(GLFWwindow* window);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void clearCoordinates();
+void loadGeneratedScene();
+void saveDocument();
+void loadDocument();
+void exportDocument();
+void startImporting(const char* path);
+void pumpImport();
+void dropCallback(GLFWwindow* window, int count, const char** paths);
 void cursorPositionCallback(GLFWwindow* window, double xpos, double ypos);
 void insertCoordinates(float xpos, float ypos, bool temporary = false);
 void characterCallback(GLFWwindow* window, unsigned int codepoint);
+bool keyPressed(GLFWwindow* window, int key);
+void cursorPosition(GLFWwindow* window, double* xpos, double* ypos);
+void setCursor(GLFWwindow* window, GLFWcursor* cursor);
+void recordInput(InputEvent event);
+bool replayFrame(GLFWwindow* window);
+void printTimes(const char* name, std::vector<double> times);
 void clearCharacterBuffer();
 void processTransformation(float x = 0.0f, float y = 0.0f);
 void refreshBuffer();
-void normalizeCoordinates(float *x, float *y);
-void renderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
\ No newline at end of file
+void uploadScene();
+void reserveScene(const char* const* columns, unsigned int size);
+void reserveTransforms(unsigned int size);
+void uploadTransforms();
+void addDrawRange(int object);
+void rebuildDrawLists();
+unsigned int allocateFill(FillArena& arena, unsigned int count);
+void uploadFill(int object, const std::vector<unsigned int>& triangles);
+void clearFills();
+void updatePreview(float x1, float y1, float x2, float y2);
+void renderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
+void flushText();
+void renderMenu();
+void initFrameTimer(FrameTimer& timer);
+void beginPass(FrameTimer& timer, Pass pass);
+void endFrameTimer(FrameTimer& timer);
+void renderHud();
\ No newline at end of file
@@ -1,17 +1,25 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <set>
 #include <algorithm>
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <chrono>
+#include <fstream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H 
+#include "core/core.h"
 #include "shaders.h"
 #include "definitions.h"
 
@@ -23,10 +31,51 @@ DrawMode drawMode = DrawMode::none;
 Transformation transformation = Transformation::none;
 
 std::vector<float> menuBoxCoordinates;
-std::vector<float> linesCoordinates;
-std::vector<float> polygonCoordinates;
-std::vector<int> polygonIndexes = { 0 };
-std::vector<std::vector<float> *> filledPolygonCoordinates;
+std::vector<float> menuQuadCoordinates;
+// everything drawn so far, the scene is used on its own often enough to get a name
+Document document;
+Scene& scene = document.scene;
+// rubber-band preview, streamed through a small ring of slots
+const int PREVIEW_SLOTS = 64;
+int previewSlot = 0;
+int previewVertices = 0;
+DrawList lineDrawList, polygonDrawList;
+// scene buffers only grow, changes are uploaded as coalesced dirty ranges
+const unsigned int DIRTY_GAP = 256;
+unsigned int sceneCapacity = 0;
+// object transforms live in a texture buffer, two texels per object, so moving a selection
+// only rewrites its matrices, they are baked into the vertices on request
+unsigned int transformBuffer, transformTexture;
+unsigned int transformCapacity = 0;
+// selection and baking are split across the cores
+ThreadPool threadPool;
+FillArena fillArena;
+// cells per side of the grid objects are indexed in
+const int GRID_SIZE = 64;
+// generated scene to start with instead of an empty canvas
+SceneSettings sceneSettings;
+bool generateOnStart = false;
+// scene file F5 saves to and F9 loads from, see --scene
+std::string scenePath = "scene.cgs";
+bool loadOnStart = false;
+// F5 writes the uncompressed file that is mapped when loaded, see --mapped
+bool mappedSaves = false;
+bool saveToggled = false;
+bool loadToggled = false;
+// SVG file F6 exports the canvas to, see --export
+std::string exportPath = "scene.svg";
+bool exportOnExit = false;
+bool exportToggled = false;
+// file read in while the editor keeps running, see --import, files dropped on the window are imported too
+Importer importer;
+std::string importPath;
+bool importOnStart = false;
+bool importing = false;
+// milliseconds a frame spends appending imported shapes, while recording or replaying it appends
+// a fixed number of batches instead, so a replay has the same scene every frame as the recording
+const double IMPORT_BUDGET = 4.0;
+const unsigned int RECORDED_IMPORT_BATCHES = 4;
+std::chrono::steady_clock::time_point importStart;
 std::vector<float> transformationWindowCoordinates;
 std::vector<char> keyboardInput1 = { '\0' };
 std::vector<char> keyboardInput2 = { '\0' };
@@ -35,15 +84,70 @@ std::string tempString = "";
 
 std::vector<unsigned int> VBO;
 std::vector<unsigned int> VAO;
+std::vector<unsigned int> sceneVBO;
+unsigned int sceneVAO;
 unsigned int vertexShader, fragmentShader, shaderProgram, textVertexShader, textFragmentShader, textShaderProgram;
-
-std::map<GLchar, Character> characters;
+unsigned int sceneVertexShader, sceneShaderProgram;
+unsigned int blitVertexShader, blitFragmentShader, blitShaderProgram;
+
+// framebuffer frames end up in, the window's own or an offscreen one when headless
+unsigned int frameTarget = 0;
+
+// the static menu is rendered once into a texture and redrawn only when it is invalidated
+unsigned int menuFramebuffer, menuTexture;
+int menuTextureWidth = 0, menuTextureHeight = 0;
+bool menuDirty = true;
+// performance overlay, see --hud, toggled with F3
+bool hudVisible = false;
+bool hudToggled = false;
+FrameTimer frameTimer;
+const int HUD_HISTORY = 240;
+// interval between frame starts and the CPU time renderFrame took, in milliseconds, as rings
+std::vector<double> frameTimes(HUD_HISTORY, 0.0), cpuTimes(HUD_HISTORY, 0.0);
+int hudFrame = 0;
+// frame intervals in the ring so far, the newest ending at hudFrame
+int hudSamples = 0;
+std::chrono::steady_clock::time_point lastFrameStart;
+std::vector<float> hudVertices;
+
+std::map<char, Glyph> characters;
+// every glyph lives in one atlas, text quads for a frame are batched into one draw
+const int ATLAS_WIDTH = 1024;
+unsigned int atlasTexture;
+int textSamplerLocation;
+std::vector<float> textVertices;
 
 bool listenForKeyboardInput = false;
 bool spaced = false;
 bool backSpaced = false;
 
 GLFWcursor *crossHairCursor, *defaultCursor, *pointerCursor;
+bool closeRequested = false;
+// the window is only redrawn once something marks the frame dirty, unless rendering is continuous, see --continuous
+bool frameDirty = true;
+bool continuousRendering = false;
+// polled keys held down in the last frame, a change redraws the frame and is recorded
+unsigned int heldKeys = 0;
+
+// input recording, see --record
+EventRecorder recorder;
+bool recording = false;
+std::chrono::steady_clock::time_point recordingStart;
+// keys processKeyboardInput polls, one bit each in keys events, the file keys F5, F9 and F6 are left out
+// so a replay never writes or reloads the scene files, older recordings kept them in bits 5 to 7
+const int POLLED_KEYS[] = { GLFW_KEY_ESCAPE, GLFW_KEY_ENTER, GLFW_KEY_BACKSPACE, GLFW_KEY_A, GLFW_KEY_F3 };
+const int POLLED_KEY_COUNT = 5;
+// replay of a recording, see --replay, the recorded input stands in for what GLFW reports
+std::vector<InputEvent> replayEvents;
+unsigned int replayPosition = 0;
+bool replaying = false;
+bool realtimeReplay = false;
+std::chrono::steady_clock::time_point replayStart;
+unsigned int replayKeys = 0;
+double replayCursorX = 0.0, replayCursorY = 0.0;
+// when the first input of the frame being replayed was handed over, for latencies
+bool replayInput = false;
+std::chrono::steady_clock::time_point replayInputTime;
 
 int WinMain() {
     // GLFW initialization
@@ -63,6 +167,7 @@ int WinMain() {
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
 
     // initializing GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -70,31 +175,339 @@ int WinMain() {
         return -1;
     }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
     // cursor
     crossHairCursor = glfwCreateStandardCursor(GLFW_CROSSHAIR_CURSOR);
     pointerCursor = glfwCreateStandardCursor(GLFW_HAND_CURSOR);
     defaultCursor = glfwCreateStandardCursor(GLFW_ARROW_CURSOR);
     glfwSetCursor(window, crossHairCursor);
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
-    glfwSetCursorPosCallback(window, cursorPositionCallback);
+    // a replay is the only input, the window's own is ignored
+    if (!replaying) {
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetCursorPosCallback(window, cursorPositionCallback);
+        glfwSetDropCallback(window, dropCallback);
+
+        // keyboard
+        glfwSetCharCallback(window, characterCallback);
+    }
+
+    initRenderer();
+
+    std::vector<double> times, latencies;
+    replayStart = std::chrono::steady_clock::now();
+    while (!glfwWindowShouldClose(window) && !closeRequested) {
+        if (replaying && !replayFrame(window)) {
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        // process keyboard input
+        processKeyboardInput(window);
+        pumpImport();
+
+        // replays time every frame, so they render continuously too
+        bool continuous = continuousRendering || replaying;
+        if (frameDirty || continuous) {
+            frameDirty = false;
+            renderFrame();
+            glfwSwapBuffers(window);
+        }
+
+        // poll IO events, or sleep until there are some, waking up to append what an import has read
+        if (continuous) {
+            glfwPollEvents();
+        }
+        else if (importing) {
+            glfwWaitEventsTimeout(0.005);
+        }
+        else {
+            glfwWaitEvents();
+        }
+
+        if (replaying) {
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            if (replayInput) {
+                latencies.push_back(std::chrono::duration<double, std::milli>(end - replayInputTime).count());
+            }
+        }
+    }
+    if (replaying) {
+        printTimes("frames", times);
+        printTimes("input latency", latencies);
+    }
+
+    // terminate, unallocating resources
+    stopImport(importer);
+    stopRecording(recorder);
+    stopThreadPool(threadPool);
+    glfwTerminate();
+    return 0;
+}
+
+#ifndef _WIN32
+int main(int argc, char** argv) {
+    // --headless [--frames N] [--size WIDTHxHEIGHT] [--output image.ppm]
+    // [--continuous] [--hud] [--record events.bin] [--replay events.bin [--realtime]]
+    // [--seed N] [--lines N] [--convex N] [--concave N] [--vertices MIN-MAX] [--fills N] [--object-size MIN-MAX]
+    // [--scene scene.cgs] [--load scene.cgs] [--mapped] [--import drawing.svg] [--export scene.svg]
+    bool headless = false;
+    int frames = 100;
+    const char* output = NULL;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--headless") {
+            headless = true;
+        }
+        else if (argument == "--frames" && i + 1 < argc) {
+            frames = std::max(1, atoi(argv[++i]));
+        }
+        else if (argument == "--size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%u", &SCR_WIDTH, &SCR_HEIGHT) != 2) {
+                std::cout << "Size must look like 700x700" << std::endl;
+                return -1;
+            }
+        }
+        else if (argument == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else if (argument == "--record" && i + 1 < argc) {
+            if (!startRecording(recorder, argv[++i])) {
+                return -1;
+            }
+            recording = true;
+            recordingStart = std::chrono::steady_clock::now();
+        }
+        else if (argument == "--replay" && i + 1 < argc) {
+            if (!readEvents(argv[++i], replayEvents)) {
+                return -1;
+            }
+            replaying = true;
+        }
+        else if (argument == "--realtime") {
+            realtimeReplay = true;
+        }
+        else if (argument == "--continuous") {
+            continuousRendering = true;
+        }
+        else if (argument == "--hud") {
+            hudVisible = true;
+        }
+        else if (argument == "--scene" && i + 1 < argc) {
+            scenePath = argv[++i];
+        }
+        else if (argument == "--mapped") {
+            mappedSaves = true;
+        }
+        else if (argument == "--load" && i + 1 < argc) {
+            scenePath = argv[++i];
+            loadOnStart = true;
+        }
+        else if (argument == "--import" && i + 1 < argc) {
+            importPath = argv[++i];
+            importOnStart = true;
+        }
+        else if (argument == "--export" && i + 1 < argc) {
+            exportPath = argv[++i];
+            exportOnExit = true;
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            sceneSettings.seed = strtoul(argv[++i], NULL, 10);
+            generateOnStart = true;
+        }
+        else if (argument == "--lines" && i + 1 < argc) {
+            sceneSettings.lines = strtoul(argv[++i], NULL, 10);
+            generateOnStart = true;
+        }
+        else if (argument == "--convex" && i + 1 < argc) {
+            sceneSettings.convexPolygons = strtoul(argv[++i], NULL, 10);
+            generateOnStart = true;
+        }
+        else if (argument == "--concave" && i + 1 < argc) {
+            sceneSettings.concavePolygons = strtoul(argv[++i], NULL, 10);
+            generateOnStart = true;
+        }
+        else if (argument == "--fills" && i + 1 < argc) {
+            sceneSettings.fills = strtoul(argv[++i], NULL, 10);
+            generateOnStart = true;
+        }
+        else if (argument == "--vertices" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u-%u", &sceneSettings.minVertices, &sceneSettings.maxVertices) != 2) {
+                std::cout << "Vertices must look like 3-8" << std::endl;
+                return -1;
+            }
+            generateOnStart = true;
+        }
+        else if (argument == "--object-size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%f-%f", &sceneSettings.minSize, &sceneSettings.maxSize) != 2) {
+                std::cout << "Object size must look like 0.02-0.2" << std::endl;
+                return -1;
+            }
+            generateOnStart = true;
+        }
+        else {
+            std::cout << "Unknown argument " << argument << std::endl;
+            return -1;
+        }
+    }
+    if (headless) {
+        return runHeadless(frames, output);
+    }
+    return WinMain();
+}
 
-    // keyboard
-    glfwSetCharCallback(window, characterCallback);
+int runHeadless(int frames, const char* output) {
+    // a display without any window system, falling back to the default one
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        std::cout << "Failed to initialize EGL" << std::endl;
+        return -1;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    EGLint configAttributes[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "Failed to find an EGL config" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cout << "Failed to create an OpenGL 3.3 context" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+
+    // frames are drawn into a renderbuffer instead of a window
+    unsigned int colorBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+    glGenFramebuffers(1, &frameTarget);
+    glBindFramebuffer(GL_FRAMEBUFFER, frameTarget);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    initRenderer();
+    // an import is read in completely before the first frame
+    while (importing) {
+        pumpImport();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // glFinish makes every frame's time cover the rendering itself, not just command submission,
+    // a replay runs until the recording is over instead of for a number of frames
+    std::vector<double> times, latencies;
+    replayStart = std::chrono::steady_clock::now();
+    for (int i = 0; replaying || i < frames; ++i) {
+        if (replaying && !replayFrame(NULL)) {
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (replaying) {
+            processKeyboardInput(NULL);
+            pumpImport();
+            if (closeRequested) {
+                break;
+            }
+        }
+        renderFrame();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        if (replaying && replayInput) {
+            latencies.push_back(std::chrono::duration<double, std::milli>(end - replayInputTime).count());
+        }
+    }
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+    if (!times.empty()) {
+        // the first frame also renders the menu and warms up the driver, it is reported separately
+        std::cout << "first frame: " << times[0] << " ms" << std::endl;
+        printTimes("frames", std::vector<double>(times.begin() + 1, times.end()));
+    }
+    printTimes("input latency", latencies);
+
+    if (output != NULL) {
+        // binary ppm, rows flipped since GL starts at the bottom
+        std::vector<unsigned char> pixels(SCR_WIDTH * SCR_HEIGHT * 3);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        std::ofstream image(output, std::ios::binary);
+        image << "P6\n" << SCR_WIDTH << " " << SCR_HEIGHT << "\n255\n";
+        for (int row = SCR_HEIGHT - 1; row >= 0; --row) {
+            image.write((const char*)&pixels[row * SCR_WIDTH * 3], SCR_WIDTH * 3);
+        }
+        if (!image) {
+            std::cout << "Failed to write " << output << std::endl;
+        }
+    }
+
+    // the canvas as it was after the last frame
+    if (exportOnExit) {
+        exportDocument();
+    }
+
+    stopImport(importer);
+    stopRecording(recorder);
+    stopThreadPool(threadPool);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    return 0;
+}
+#endif
+
+void initRenderer() {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // initialize vertex buffer object
-    VBO.assign({ 0, 0, 0, 0, 0 });
+    VBO.assign({ 0, 0, 0, 0, 0, 0 });
     for (int i = 0; i < VBO.size(); ++i) {
         glGenBuffers(1, &VBO[i]);
     }
+    sceneVBO.assign({ 0, 0, 0 });
+    for (int i = 0; i < sceneVBO.size(); ++i) {
+        glGenBuffers(1, &sceneVBO[i]);
+    }
 
     // initialize vertex array object
-    VAO.assign({ 0, 0, 0, 0, 0 });
+    VAO.assign({ 0, 0, 0, 0, 0, 0 });
     for (int i = 0; i < VAO.size(); ++i) {
         glGenVertexArrays(1, &VAO[i]);
     }
+    glGenVertexArrays(1, &sceneVAO);
+    initDocument(document, GRID_SIZE);
+    glGenBuffers(1, &fillArena.buffer);
+    glGenBuffers(1, &transformBuffer);
+    glGenTextures(1, &transformTexture);
+    initFrameTimer(frameTimer);
+    selectTransformKernel();
+    startThreadPool(threadPool, std::thread::hardware_concurrency());
 
     // initialize vertex shader
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -103,6 +516,12 @@ int WinMain() {
     textVertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(textVertexShader, 1, &textVertexShaderSource, NULL);
     glCompileShader(textVertexShader);
+    sceneVertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(sceneVertexShader, 1, &sceneVertexShaderSource, NULL);
+    glCompileShader(sceneVertexShader);
+    blitVertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(blitVertexShader, 1, &blitVertexShaderSource, NULL);
+    glCompileShader(blitVertexShader);
 
     // initialize fragment shader
     fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -111,13 +530,23 @@ int WinMain() {
     textFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(textFragmentShader, 1, &textFragmentShaderSource, NULL);
     glCompileShader(textFragmentShader);
+    blitFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(blitFragmentShader, 1, &blitFragmentShaderSource, NULL);
+    glCompileShader(blitFragmentShader);
 
     // initialize shader program
     shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
     glLinkProgram(shaderProgram);
+    sceneShaderProgram = glCreateProgram();
+    glAttachShader(sceneShaderProgram, sceneVertexShader);
+    glAttachShader(sceneShaderProgram, fragmentShader);
+    glLinkProgram(sceneShaderProgram);
+    glUseProgram(sceneShaderProgram);
+    glUniform1i(glGetUniformLocation(sceneShaderProgram, "transforms"), 1);
     glDeleteShader(vertexShader);
+    glDeleteShader(sceneVertexShader);
     glDeleteShader(fragmentShader);
     textShaderProgram = glCreateProgram();
     glAttachShader(textShaderProgram, textVertexShader);
@@ -125,19 +554,41 @@ int WinMain() {
     glLinkProgram(textShaderProgram);
     glDeleteShader(textVertexShader);
     glDeleteShader(textFragmentShader);
+    textSamplerLocation = glGetUniformLocation(textShaderProgram, "text");
+    glUseProgram(textShaderProgram);
+    glUniform1i(textSamplerLocation, 0);
+    blitShaderProgram = glCreateProgram();
+    glAttachShader(blitShaderProgram, blitVertexShader);
+    glAttachShader(blitShaderProgram, blitFragmentShader);
+    glLinkProgram(blitShaderProgram);
+    glDeleteShader(blitVertexShader);
+    glDeleteShader(blitFragmentShader);
+    glUseProgram(blitShaderProgram);
+    glUniform1i(glGetUniformLocation(blitShaderProgram, "image"), 0);
 
     // bind VAO and VBO
     for (int i = 0; i < VAO.size(); ++i) {
         glBindVertexArray(VAO[i]);
         glBindBuffer(GL_ARRAY_BUFFER, VBO[i]);
-        if (i == 3) { // different for text VBO
-            glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+        if (i == 1) { // different for text VBO
+            glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+        }
+        else if (i == 3) { // preview ring, one segment per slot
+            glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * PREVIEW_SLOTS, NULL, GL_STREAM_DRAW);
+        }
+        else if (i == 5) { // hud histogram, rewritten every frame
+            glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
         }
         else {
             glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
         }
         glEnableVertexAttribArray(0);
-        if (i == 3) { // different for text VAO
+        if (i == 1) { // different for text VAO, position and texture coordinates followed by color
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), 0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void*)(4 * sizeof(GLfloat)));
+        }
+        else if (i == 4) { // menu quad, position and texture coordinates
             glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
         }
         else {
@@ -145,6 +596,29 @@ int WinMain() {
         }
     }
 
+    // scene VAO reads x, y and the object index from their own buffers
+    glBindVertexArray(sceneVAO);
+    for (int i = 0; i < sceneVBO.size(); ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, sceneVBO[i]);
+        glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(i);
+        if (i == 2) { // object index, kept as an integer
+            glVertexAttribIPointer(i, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+        }
+        else {
+            glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        }
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, fillArena.buffer);
+
+    // transform buffer stays bound to texture unit 1
+    glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformBuffer);
+    glActiveTexture(GL_TEXTURE0);
+
     // text
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) {
@@ -159,6 +633,10 @@ int WinMain() {
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
+    // pack glyphs into shelves, leaving a pixel between them so filtering never bleeds
+    std::vector<unsigned char> atlas;
+    int atlasHeight = 0, shelfX = 1, shelfY = 1, shelfHeight = 0;
+    std::map<GLchar, glm::ivec2> positions;
     for (GLubyte c = 0; c < 128; c++)
     {
         // load character glyph 
@@ -167,35 +645,61 @@ int WinMain() {
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
             continue;
         }
-        // generate texture
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        int width = face->glyph->bitmap.width;
+        int rows = face->glyph->bitmap.rows;
+        if (shelfX + width + 1 > ATLAS_WIDTH) {
+            shelfX = 1;
+            shelfY += shelfHeight + 1;
+            shelfHeight = 0;
+        }
+        if (shelfY + rows + 1 > atlasHeight) {
+            atlasHeight = shelfY + rows + 1;
+            atlas.resize(ATLAS_WIDTH * atlasHeight, 0);
+        }
+        for (int row = 0; row < rows; ++row) {
+            memcpy(&atlas[(shelfY + row) * ATLAS_WIDTH + shelfX], face->glyph->bitmap.buffer + row * face->glyph->bitmap.pitch, width);
+        }
+        positions[c] = glm::ivec2(shelfX, shelfY);
+        shelfX += width + 1;
+        shelfHeight = std::max(shelfHeight, rows);
+
         // now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
+        Glyph character = {
+            { 0.0f, 0.0f },
+            { 0.0f, 0.0f },
+            { (int)face->glyph->bitmap.width, (int)face->glyph->bitmap.rows },
+            { face->glyph->bitmap_left, face->glyph->bitmap_top },
+            (unsigned int)face->glyph->advance.x
         };
-        characters.insert(std::pair<GLchar, Character>(c, character));
+        characters.insert(std::pair<char, Glyph>(c, character));
+    }
+    for (auto& character : characters) {
+        glm::ivec2 position = positions[character.first];
+        character.second.uvMin[0] = (float)position.x / ATLAS_WIDTH;
+        character.second.uvMin[1] = (float)position.y / atlasHeight;
+        character.second.uvMax[0] = (float)(position.x + character.second.size[0]) / ATLAS_WIDTH;
+        character.second.uvMax[1] = (float)(position.y + character.second.size[1]) / atlasHeight;
     }
+
+    // generate texture
+    glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RED,
+        ATLAS_WIDTH,
+        atlasHeight,
+        0,
+        GL_RED,
+        GL_UNSIGNED_BYTE,
+        atlas.data()
+    );
+    // set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
     // destroy FreeType once we're finished
     FT_Done_Face(face);
@@ -341,91 +845,284 @@ int WinMain() {
     });
 
     // box buffer data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[4]);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * menuBoxCoordinates.size(), &menuBoxCoordinates[0], GL_STATIC_DRAW);
 
-    while (!glfwWindowShouldClose(window)) {
-        // process keyboard input
-        processKeyboardInput(window);
+    // quad over the menu box, with a margin for the border lines
+    menuQuadCoordinates.assign({
+        -0.96f, 0.96f, 0.02f, 0.98f,
+        -0.96f, 0.415f, 0.02f, 0.7075f,
+        -0.115f, 0.415f, 0.4425f, 0.7075f,
+        -0.96f, 0.96f, 0.02f, 0.98f,
+        -0.115f, 0.415f, 0.4425f, 0.7075f,
+        -0.115f, 0.96f, 0.4425f, 0.98f
+    });
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[4]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * menuQuadCoordinates.size(), &menuQuadCoordinates[0], GL_STATIC_DRAW);
 
-        //render
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // headings
-        renderText("Menu", -0.59f, 0.90f, 0.75f, glm::vec3(0.1484375f, 0.20703125f, 0.828125f));
-        renderText("Draw", -0.85f, 0.84f, 0.6f, glm::vec3(0.1484375f, 0.20703125f, 0.828125f));
-        renderText("Transform", -0.48f, 0.84f, 0.6f, glm::vec3(0.1484375f, 0.20703125f, 0.828125f));
-        // draw menu
-        renderText("Line", -0.83f, 0.7625f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Polygon", -0.86f, 0.69f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Flood Fill", -0.87f, 0.615f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Clear", -0.84f, 0.54f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        // transform menu
-        renderText("Translate", -0.579f, 0.7625f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Rotate", -0.33f, 0.7625f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Reflect X", -0.573f, 0.687f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Reflect Y", -0.343f, 0.687f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Reflect Origin", -0.595f, 0.615f, 0.45f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Scale", -0.32f, 0.615f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("X-Shear", -0.566f, 0.54f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Y-Shear", -0.339f, 0.54f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
-        renderText("Cancel", -0.442f, 0.465f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    // menu render target
+    glGenFramebuffers(1, &menuFramebuffer);
+    glGenTextures(1, &menuTexture);
 
-        if (listenForKeyboardInput) {
-            std::string firstString = keyboardInput1.data();
-            std::string secondString = keyboardInput2.data();
-            if (transformation == Transformation::translation || transformation == Transformation::scaling) {
-                tempString = "Enter transformation factors: [X: " + firstString + ", Y: " + secondString + "]";
-            }
-            else {
-                tempString = "Enter transformation factor: " + firstString;
-            }
-            renderText(tempString, -0.1f, 0.9f, 0.75f, glm::vec3(0.0f, 0.0f, 0.0f));
-        }
+    // scene asked for on the command line
+    if (loadOnStart) {
+        loadDocument();
+    }
+    else if (generateOnStart) {
+        loadGeneratedScene();
+    }
+    if (importOnStart) {
+        startImporting(importPath.c_str());
+    }
+}
 
-        // draw
-        glUseProgram(shaderProgram);
-        int i = 0;
-        glBindVertexArray(VAO[i++]);
-        glDrawArrays(GL_LINES, 0, (linesCoordinates.size() / 3) + 1);
-        glBindVertexArray(VAO[i++]);
-        glDrawArrays(GL_LINES, 0, (polygonCoordinates.size() / 3) + 2);
-        glBindVertexArray(VAO[i++]);
-        glDrawArrays(GL_LINE_LOOP, 0, 4);
+void renderFrame() {
+    auto frameStart = std::chrono::steady_clock::now();
+    if (lastFrameStart.time_since_epoch().count() != 0) {
+        frameTimes[hudFrame] = std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count();
+        hudSamples = std::min(hudSamples + 1, HUD_HISTORY);
+    }
+    lastFrameStart = frameStart;
 
-        // again for text (happens in a different function)
-        i++;
+    //render
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
 
-        glBindVertexArray(VAO[i++]);
-        glDrawArrays(GL_LINES, 0, menuBoxCoordinates.size() / 3);
+    // menu
+    beginPass(frameTimer, Pass::ui);
+    if (menuDirty) {
+        renderMenu();
+    }
+    glUseProgram(blitShaderProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, menuTexture);
+    glBindVertexArray(VAO[4]);
+    // the cached image is premultiplied
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        for (int j = i; j < VAO.size(); ++j) {
-            glBindVertexArray(VAO[j]);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, filledPolygonCoordinates[j - i]->size() / 3);
+    if (listenForKeyboardInput) {
+        std::string firstString = keyboardInput1.data();
+        std::string secondString = keyboardInput2.data();
+        if (transformation == Transformation::translation || transformation == Transformation::scaling) {
+            tempString = "Enter transformation factors: [X: " + firstString + ", Y: " + secondString + "]";
         }
+        else {
+            tempString = "Enter transformation factor: " + firstString;
+        }
+        renderText(tempString, -0.1f, 0.9f, 0.75f, glm::vec3(0.0f, 0.0f, 0.0f));
+    }
+    beginPass(frameTimer, Pass::text);
+    flushText();
+
+    // draw
+    beginPass(frameTimer, Pass::scene);
+    glUseProgram(sceneShaderProgram);
+    glBindVertexArray(sceneVAO);
+    glMultiDrawArrays(GL_LINE_STRIP, lineDrawList.firsts.data(), lineDrawList.counts.data(), lineDrawList.firsts.size());
+    glMultiDrawArrays(GL_LINE_LOOP, polygonDrawList.firsts.data(), polygonDrawList.counts.data(), polygonDrawList.firsts.size());
+    if (document.openObject != -1) {
+        // object still being drawn
+        glDrawArrays(scene.types[document.openObject] == ObjectType::line ? GL_LINES : GL_LINE_STRIP,
+            scene.offsets[document.openObject], scene.counts[document.openObject]);
+    }
+
+    beginPass(frameTimer, Pass::ui);
+    glUseProgram(shaderProgram);
+    glBindVertexArray(VAO[0]);
+    glDrawArrays(GL_LINE_LOOP, 0, 4);
+    glBindVertexArray(VAO[3]);
+    glDrawArrays(GL_LINES, previewSlot * 2, previewVertices);
 
-        // swap buffers and poll IO events
-        glfwPollEvents();
-        glfwSwapBuffers(window);
+    beginPass(frameTimer, Pass::fills);
+    glUseProgram(sceneShaderProgram);
+    glBindVertexArray(sceneVAO);
+    glMultiDrawElements(GL_TRIANGLES, fillArena.counts.data(), GL_UNSIGNED_INT, fillArena.offsets.data(), fillArena.counts.size());
+
+    if (hudVisible) {
+        beginPass(frameTimer, Pass::ui);
+        renderHud();
+    }
+    endFrameTimer(frameTimer);
+    cpuTimes[hudFrame] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    hudFrame = (hudFrame + 1) % HUD_HISTORY;
+}
+void initFrameTimer(FrameTimer& timer) {
+    glGenQueries(TIMER_FRAMES * TIMER_SECTIONS, &timer.queries[0][0]);
+    for (int f = 0; f < TIMER_FRAMES; ++f) {
+        timer.sections[f] = 0;
+    }
+    timer.frame = 0;
+    timer.open = -1;
+    for (int p = 0; p < 4; ++p) {
+        timer.gpu[p] = 0.0;
+    }
+}
+void beginPass(FrameTimer& timer, Pass pass) {
+    // ends the running section and starts timing the next one, queries are only issued while the hud is up
+    if (!hudVisible) {
+        return;
+    }
+    if (timer.open != -1) {
+        glEndQuery(GL_TIME_ELAPSED);
+        timer.open = -1;
+    }
+    int& sections = timer.sections[timer.frame];
+    if (sections < TIMER_SECTIONS) {
+        glBeginQuery(GL_TIME_ELAPSED, timer.queries[timer.frame][sections]);
+        timer.passes[timer.frame][sections] = pass;
+        timer.open = sections++;
+    }
+}
+void endFrameTimer(FrameTimer& timer) {
+    if (timer.open != -1) {
+        glEndQuery(GL_TIME_ELAPSED);
+        timer.open = -1;
     }
 
-    // terminate, unallocating resources
-    glfwTerminate();
-    return 0;
+    // the oldest slot is reused next, its results are only read when they are all available, waiting for
+    // them would stall on the GPU, otherwise the slot is dropped and the previous times are kept
+    timer.frame = (timer.frame + 1) % TIMER_FRAMES;
+    int count = timer.sections[timer.frame];
+    GLuint available = 1;
+    for (int k = 0; k < count && available; ++k) {
+        glGetQueryObjectuiv(timer.queries[timer.frame][k], GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    if (count > 0 && available) {
+        double gpu[4] = { 0.0, 0.0, 0.0, 0.0 };
+        for (int k = 0; k < count; ++k) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(timer.queries[timer.frame][k], GL_QUERY_RESULT, &elapsed);
+            gpu[(unsigned int)timer.passes[timer.frame][k]] += elapsed / 1e6;
+        }
+        std::copy(gpu, gpu + 4, timer.gpu);
+    }
+    timer.sections[timer.frame] = 0;
+}
+void renderHud() {
+    // frame interval and CPU time with percentiles over the history, the newest GPU times per pass,
+    // and a histogram of the frame intervals where the full height is 33 ms, only measured intervals count
+    std::vector<double> sorted;
+    for (int k = 0; k < hudSamples; ++k) {
+        sorted.push_back(frameTimes[(hudFrame + HUD_HISTORY - k) % HUD_HISTORY]);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    double p50 = sorted.empty() ? 0.0 : sorted[sorted.size() / 2];
+    double p99 = sorted.empty() ? 0.0 : sorted[sorted.size() * 99 / 100];
+    double totalGpu = frameTimer.gpu[0] + frameTimer.gpu[1] + frameTimer.gpu[2] + frameTimer.gpu[3];
+    char line[128];
+    glm::vec3 color(0.1f, 0.1f, 0.8f);
+    snprintf(line, sizeof(line), "frame %.2f ms  p50 %.2f  p99 %.2f", frameTimes[hudFrame], p50, p99);
+    renderText(line, -0.95f, -0.83f, 0.5f, color);
+    snprintf(line, sizeof(line), "cpu %.2f ms  gpu %.3f ms", cpuTimes[(hudFrame + HUD_HISTORY - 1) % HUD_HISTORY], totalGpu);
+    renderText(line, -0.95f, -0.88f, 0.5f, color);
+    snprintf(line, sizeof(line), "scene %.3f  fills %.3f  text %.3f  ui %.3f ms",
+        frameTimer.gpu[(unsigned int)Pass::scene], frameTimer.gpu[(unsigned int)Pass::fills],
+        frameTimer.gpu[(unsigned int)Pass::text], frameTimer.gpu[(unsigned int)Pass::ui]);
+    renderText(line, -0.95f, -0.93f, 0.5f, color);
+    flushText();
+
+    // oldest bar on the left, with a line at 16.7 ms
+    const float left = -0.95f, bottom = -0.78f, width = 0.6f, height = 0.2f;
+    hudVertices.clear();
+    for (int k = HUD_HISTORY - hudSamples; k < HUD_HISTORY; ++k) {
+        float x = left + width * k / HUD_HISTORY;
+        float h = height * (float)std::min(frameTimes[(hudFrame + 1 + k) % HUD_HISTORY] / 33.3, 1.0);
+        hudVertices.insert(hudVertices.end(), { x, bottom, 0.0f, x, bottom + h, 0.0f });
+    }
+    float target = bottom + height * 16.7f / 33.3f;
+    hudVertices.insert(hudVertices.end(), { left, target, 0.0f, left + width, target, 0.0f });
+    glUseProgram(shaderProgram);
+    glBindVertexArray(VAO[5]);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[5]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * hudVertices.size(), hudVertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_LINES, 0, hudVertices.size() / 3);
 }
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
     SCR_WIDTH = width;
     SCR_HEIGHT = height;
+    menuDirty = true;
+    frameDirty = true;
+}
+void windowRefreshCallback(GLFWwindow* window) {
+    // the window was uncovered or resized and its contents are gone
+    frameDirty = true;
+}
+
+void renderMenu() {
+    // match the framebuffer so glyphs and lines land on the same pixels as before
+    glBindTexture(GL_TEXTURE_2D, menuTexture);
+    if (menuTextureWidth != SCR_WIDTH || menuTextureHeight != SCR_HEIGHT) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, menuFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, menuTexture, 0);
+        menuTextureWidth = SCR_WIDTH;
+        menuTextureHeight = SCR_HEIGHT;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, menuFramebuffer);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    // keep alpha separate so the texture ends up premultiplied
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    // headings
+    renderText("Menu", -0.59f, 0.90f, 0.75f, glm::vec3(0.1484375f, 0.20703125f, 0.828125f));
+    renderText("Draw", -0.85f, 0.84f, 0.6f, glm::vec3(0.1484375f, 0.20703125f, 0.828125f));
+    renderText("Transform", -0.48f, 0.84f, 0.6f, glm::vec3(0.1484375f, 0.20703125f, 0.828125f));
+    // draw menu
+    renderText("Line", -0.83f, 0.7625f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Polygon", -0.86f, 0.69f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Flood Fill", -0.87f, 0.615f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Clear", -0.84f, 0.54f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    // transform menu
+    renderText("Translate", -0.579f, 0.7625f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Rotate", -0.33f, 0.7625f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Reflect X", -0.573f, 0.687f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Reflect Y", -0.343f, 0.687f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Reflect Origin", -0.595f, 0.615f, 0.45f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Scale", -0.32f, 0.615f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("X-Shear", -0.566f, 0.54f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Y-Shear", -0.339f, 0.54f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    renderText("Cancel", -0.442f, 0.465f, 0.525f, glm::vec3(0.0f, 0.0f, 0.0f));
+    flushText();
+
+    // box and buttons
+    glUseProgram(shaderProgram);
+    glBindVertexArray(VAO[2]);
+    glDrawArrays(GL_LINES, 0, menuBoxCoordinates.size() / 3);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindFramebuffer(GL_FRAMEBUFFER, frameTarget);
+    menuDirty = false;
 }
 
 void processKeyboardInput(GLFWwindow* window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
+    // runs once per frame, so the recording marks frames here, after any change to the keys held down
+    unsigned int keys = 0;
+    for (int k = 0; k < POLLED_KEY_COUNT; ++k) {
+        if (keyPressed(window, POLLED_KEYS[k])) {
+            keys |= 1 << k;
+        }
+    }
+    if (keys != heldKeys) {
+        InputEvent event = { EventType::keys };
+        event.value = keys;
+        recordInput(event);
+        heldKeys = keys;
+        frameDirty = true;
     }
-    else if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
+    recordInput({ EventType::frame });
+
+    if (keyPressed(window, GLFW_KEY_ESCAPE)) {
+        closeRequested = true;
+    }
+    else if (keyPressed(window, GLFW_KEY_ENTER)) {
         if (listenForKeyboardInput) {
             if (transformation == Transformation::translation ||
                 transformation == Transformation::scaling ||
@@ -442,7 +1139,7 @@ void processKeyboardInput(GLFWwindow* window) {
             clearCharacterBuffer();
         }
     }
-    else if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS) {
+    else if (keyPressed(window, GLFW_KEY_BACKSPACE)) {
         if (!backSpaced && listenForKeyboardInput) {
             if (keyboardInput2.size() == 1) {
                 spaced = false;
@@ -462,17 +1159,61 @@ void processKeyboardInput(GLFWwindow* window) {
             backSpaced = true;
         }
     }
-    else if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_RELEASE) {
+    else if (!keyPressed(window, GLFW_KEY_BACKSPACE)) {
         backSpaced = false;
     }
+    if (keyPressed(window, GLFW_KEY_F3)) {
+        if (!hudToggled) {
+            hudVisible = !hudVisible;
+            hudToggled = true;
+        }
+    }
+    else {
+        hudToggled = false;
+    }
+    if (keyPressed(window, GLFW_KEY_F5)) {
+        if (!saveToggled) {
+            saveDocument();
+            saveToggled = true;
+        }
+    }
+    else {
+        saveToggled = false;
+    }
+    if (keyPressed(window, GLFW_KEY_F9)) {
+        if (!loadToggled) {
+            loadDocument();
+            loadToggled = true;
+        }
+    }
+    else {
+        loadToggled = false;
+    }
+    if (keyPressed(window, GLFW_KEY_F6)) {
+        if (!exportToggled) {
+            exportDocument();
+            exportToggled = true;
+        }
+    }
+    else {
+        exportToggled = false;
+    }
+    if (keyPressed(window, GLFW_KEY_A) && !listenForKeyboardInput) {
+        // apply, objects without a pending transform are skipped so holding the key is harmless
+        if (bakeTransforms(document, threadPool)) {
+            uploadScene();
+        }
+    }
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
     double xpos, ypos;
-    glfwGetCursorPos(window, &xpos, &ypos);
+    cursorPosition(window, &xpos, &ypos);
+    recordInput({ EventType::mouseButton, 0, (float)xpos, (float)ypos, button, action, mods });
+    frameDirty = true;
 
     float x = (float)xpos, y = (float)ypos;
-    normalizeCoordinates(&x, &y);
+    normalizeCoordinates(&x, &y, SCR_WIDTH, SCR_HEIGHT);
 
     if (x > -0.125f || y < 0.425f || x < -0.95f || y > 0.95f) {
         if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
@@ -536,57 +1277,156 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
 }
 
 void clearCoordinates() {
-    linesCoordinates.clear();
-    polygonCoordinates.clear();
-    polygonIndexes.clear();
-    polygonIndexes.push_back(0);
-    for (int i = 0; i < filledPolygonCoordinates.size(); ++i) {
-        filledPolygonCoordinates[i]->clear();
-        delete filledPolygonCoordinates[i];
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[i + 5]);
-        glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
-        glDeleteBuffers(1, &VAO[i + 5]);
-        glDeleteBuffers(1, &VBO[i + 5]);
-    }
-    for (int i = 0; i < filledPolygonCoordinates.size(); ++i) {
-        VAO.pop_back();
-        VBO.pop_back();
-    }
-    filledPolygonCoordinates.clear();
+    stopImport(importer);
+    importing = false;
+    clearDocument(document);
+    clearFills();
+    previewVertices = 0;
+    rebuildDrawLists();
     transformationWindowCoordinates.clear();
-    for (int i = 0; i < VBO.size(); ++i) {
-        if (i != 3 && i != 4) {
-            glBindBuffer(GL_ARRAY_BUFFER, VBO[i]);
-            glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
-        }
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
     listenForKeyboardInput = false;
     clearCharacterBuffer();
 }
+void loadGeneratedScene() {
+    std::vector<unsigned int> fills, polygons;
+    generateScene(document, sceneSettings, fills, polygons);
+    for (int k = 0; k < fills.size(); ++k) {
+        uploadFill(fills[k], document.triangulations[scene.ids[polygons[k]]]);
+    }
+    rebuildDrawLists();
+    uploadScene();
+    std::cout << "generated " << scene.ids.size() << " objects with " << scene.x.size() << " vertices" << std::endl;
+}
+void saveDocument() {
+    // a line or polygon still being drawn is left out
+    auto start = std::chrono::steady_clock::now();
+    bool saved = mappedSaves ? saveMappedScene(document, scenePath.c_str()) : saveScene(document, threadPool, scenePath.c_str());
+    if (saved) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "saved " << scenePath << " in " << elapsed.count() << " ms" << std::endl;
+    }
+}
+void loadDocument() {
+    // the file is read into a document of its own, the canvas is only replaced once it could be read
+    auto start = std::chrono::steady_clock::now();
+    Document loaded;
+    initDocument(loaded, GRID_SIZE);
+    std::vector<unsigned int> fills, polygons;
+    MappedScene mapped;
+    bool isMapped = isMappedScene(scenePath.c_str());
+    bool read = isMapped ? openMappedScene(mapped, scenePath.c_str()) && loadMappedScene(loaded, threadPool, mapped, fills, polygons) :
+        loadScene(loaded, threadPool, scenePath.c_str(), fills, polygons);
+    if (!read) {
+        closeMappedScene(mapped);
+        return;
+    }
 
-void refreshBuffer() {
-    // make sure coordinates are always even
-    if (linesCoordinates.size() % 6 == 3) {
-        linesCoordinates.pop_back();
-        linesCoordinates.pop_back();
-        linesCoordinates.pop_back();
+    clearCoordinates();
+    document = std::move(loaded);
+    if (isMapped) {
+        // the vertex columns and transform texels go to the GPU straight from the mapping,
+        // the document got copies of the tables
+        const char* columns[] = { (const char*)mapped.x, (const char*)mapped.y, (const char*)mapped.objects };
+        reserveScene(columns, mapped.vertexCount);
+        reserveTransforms(mapped.objectCount);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(float) * 8 * mapped.objectCount, mapped.texels);
+        document.sceneDirty.offsets.clear();
+        document.sceneDirty.counts.clear();
+        document.transformDirty.offsets.clear();
+        document.transformDirty.counts.clear();
+        closeMappedScene(mapped);
+    }
+    for (int k = 0; k < fills.size(); ++k) {
+        uploadFill(fills[k], document.triangulations[scene.ids[polygons[k]]]);
+    }
+    rebuildDrawLists();
+    uploadScene();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "loaded " << scene.ids.size() << " objects with " << scene.x.size() << " vertices from " << scenePath
+        << " in " << elapsed.count() << " ms" << std::endl;
+}
+
+void exportDocument() {
+    // a line or polygon still being drawn is left out
+    auto start = std::chrono::steady_clock::now();
+    if (exportSvg(document, exportPath.c_str(), SCR_WIDTH, SCR_HEIGHT)) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "exported " << exportPath << " in " << elapsed.count() << " ms" << std::endl;
+    }
+}
+void startImporting(const char* path) {
+    // the shapes are fitted into the canvas and added to what is already there
+    importing = startImport(importer, path, SCR_WIDTH, SCR_HEIGHT);
+    importPath = path;
+    importStart = std::chrono::steady_clock::now();
+}
+void pumpImport() {
+    // appends what the import has read so far, within the frame's budget, and never while an object is being drawn
+    if (!importing || document.openObject != -1) {
+        return;
     }
-    if (polygonCoordinates.size() != polygonIndexes.back()) {
-        while (polygonCoordinates.size() != polygonIndexes.back()) {
-            polygonCoordinates.pop_back();
+    auto start = std::chrono::steady_clock::now();
+    unsigned int firstObject = scene.ids.size();
+    ImportBatch batch;
+    bool done = false;
+    if (recording || replaying) {
+        // waits for the batches, and only ends once there are none left, independent of how fast the file is read
+        for (unsigned int k = 0; k < RECORDED_IMPORT_BATCHES && !done; ++k) {
+            done = !waitImportBatch(importer, batch);
+            if (!done) {
+                appendImportBatch(document, batch);
+            }
+        }
+    }
+    else {
+        while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < IMPORT_BUDGET &&
+            takeImportBatch(importer, batch)) {
+            appendImportBatch(document, batch);
+        }
+        done = !importRunning(importer);
+    }
+    if (scene.ids.size() > firstObject) {
+        for (int i = firstObject; i < scene.ids.size(); ++i) {
+            addDrawRange(i);
         }
+        uploadScene();
+    }
+    if (done) {
+        stopImport(importer);
+        importing = false;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - importStart;
+        std::cout << "imported " << importPath << ", the scene has " << scene.ids.size() << " objects with " << scene.x.size()
+            << " vertices after " << elapsed.count() << " ms" << std::endl;
     }
+}
+void dropCallback(GLFWwindow* window, int count, const char** paths) {
+    // only the first file is imported, the drop is recorded with its path
+    InputEvent event = { EventType::drop };
+    event.path = paths[0];
+    recordInput(event);
+    if (!importing && document.openObject == -1) {
+        startImporting(paths[0]);
+    }
+}
+
+void refreshBuffer() {
+    // drop the line or polygon that was not finished
+    dropOpenObject(document);
+    previewVertices = 0;
 
     // clean
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
     glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
     listenForKeyboardInput = false;
     clearCharacterBuffer();
 }
 
 void cursorPositionCallback(GLFWwindow* window, double xpos, double ypos) {
+    recordInput({ EventType::cursor, 0, (float)xpos, (float)ypos });
     float x = (float)xpos, y = (float)ypos;
-    normalizeCoordinates(&x, &y);
+    normalizeCoordinates(&x, &y, SCR_WIDTH, SCR_HEIGHT);
 
     if ((x >= -0.49f && x <= -0.29f && y >= 0.45f && y <= 0.50f) || 
         (x >= -0.375f && x <= -0.175f && y >= 0.525f && y <= 0.575f) ||
@@ -601,29 +1441,25 @@ void cursorPositionCallback(GLFWwindow* window, double xpos, double ypos) {
         (x >= -0.90f && x <= -0.70f && y >= 0.60f && y <= 0.65f) ||
         (x >= -0.90f && x <= -0.70f && y >= 0.675f && y <= 0.725f) ||
         (x >= -0.90f && x <= -0.70f && y >= 0.75f && y <= 0.80f)) {
-        glfwSetCursor(window, pointerCursor);
+        setCursor(window, pointerCursor);
     }
     else if (x <= -0.125f && y >= 0.425f && x >= -0.95f && y <= 0.95f) {
-        glfwSetCursor(window, defaultCursor);
+        setCursor(window, defaultCursor);
     }
     else {
-        glfwSetCursor(window, crossHairCursor);
+        setCursor(window, crossHairCursor);
         if (transformation != Transformation::none) {
             if (transformationWindowCoordinates.size() % 6 == 3) {
                 // add coordinates temporarily
                 insertCoordinates((float)xpos, (float)ypos, true);
+                frameDirty = true;
             }
         }
-        else if (drawMode == DrawMode::line) {
-            if (linesCoordinates.size() % 6 == 3) {
-                // add coordinates temporarily
-                insertCoordinates((float)xpos, (float)ypos, true);
-            }
-        }
-        else if (drawMode == DrawMode::polygon) {
-            if (polygonCoordinates.size() > polygonIndexes.back()) {
+        else if (drawMode == DrawMode::line || drawMode == DrawMode::polygon) {
+            if (document.openObject != -1) {
                 // add coordinates temporarily
                 insertCoordinates((float)xpos, (float)ypos, true);
+                frameDirty = true;
             }
         }
     }
@@ -632,7 +1468,7 @@ void cursorPositionCallback(GLFWwindow* window, double xpos, double ypos) {
 void insertCoordinates(float xpos, float ypos, bool temporary) {
     float xValue = xpos;
     float yValue = ypos;
-    normalizeCoordinates(&xValue, &yValue);
+    normalizeCoordinates(&xValue, &yValue, SCR_WIDTH, SCR_HEIGHT);
 
     if (transformation != Transformation::none) {
         if (transformationWindowCoordinates.size() % 6 == 0) {
@@ -670,7 +1506,7 @@ void insertCoordinates(float xpos, float ypos, bool temporary) {
         }
         // draw
         if (transformationWindowCoordinates.size() % 6 == 0) {
-            glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
             glBufferData(GL_ARRAY_BUFFER, sizeof(float) * transformationWindowCoordinates.size(), &transformationWindowCoordinates[0], GL_STATIC_DRAW);
         }
 
@@ -687,123 +1523,65 @@ void insertCoordinates(float xpos, float ypos, bool temporary) {
         }
     }
     else if (drawMode == DrawMode::line) {
-        linesCoordinates.push_back(xValue);
-        linesCoordinates.push_back(yValue);
-        linesCoordinates.push_back(0.0f);
-
-        // draw
-        if (linesCoordinates.size() % 6 == 0) {
-            glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(float) * linesCoordinates.size(), &linesCoordinates[0], GL_STATIC_DRAW);
+        if (temporary) {
+            // rubber band from the first end point to the cursor
+            if (document.openObject != -1) {
+                unsigned int first = scene.offsets[document.openObject];
+                updatePreview(scene.x[first], scene.y[first], xValue, yValue);
+            }
         }
+        else {
+            int finished = addLinePoint(document, xValue, yValue);
+            if (finished != -1) {
+                addDrawRange(finished);
+            }
+            previewVertices = 0;
 
-        if (temporary) {
-            linesCoordinates.pop_back();
-            linesCoordinates.pop_back();
-            linesCoordinates.pop_back();
+            // draw
+            uploadScene();
         }
     }
     else if (drawMode == DrawMode::polygon) {
         if (temporary) {
-            if (polygonCoordinates.size() > polygonIndexes.back() + 3 && abs(xValue - polygonCoordinates[polygonIndexes.back()]) < 0.05f && abs(yValue - polygonCoordinates[polygonIndexes.back() + 1]) < 0.05f) {
-                polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                polygonCoordinates.push_back(0.0f);
-
-                polygonCoordinates.push_back(polygonCoordinates[polygonIndexes.back()]);
-                polygonCoordinates.push_back(polygonCoordinates[polygonIndexes.back() + 1]);
-                polygonCoordinates.push_back(0.0f);
-            }
-            else {
-                if (polygonCoordinates.size() > polygonIndexes.back() + 3) {
-                    polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                    polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                    polygonCoordinates.push_back(0.0f);
-                }
-                polygonCoordinates.push_back(xValue);
-                polygonCoordinates.push_back(yValue);
-                polygonCoordinates.push_back(0.0f);
-            }
-        }
-        else {
-            if ((polygonCoordinates.size() - polygonIndexes.back()) % 6 == 3) {
-                polygonCoordinates.push_back(xValue);
-                polygonCoordinates.push_back(yValue);
-                polygonCoordinates.push_back(0.0f);
-            }
-            else {
-                if (polygonCoordinates.size() > polygonIndexes.back() + 3 && abs(xValue - polygonCoordinates[polygonIndexes.back()]) < 0.05f && abs(yValue - polygonCoordinates[polygonIndexes.back() + 1]) < 0.05f) {
-                    polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                    polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                    polygonCoordinates.push_back(0.0f);
-                    polygonCoordinates.push_back(polygonCoordinates[polygonIndexes.back()]);
-                    polygonCoordinates.push_back(polygonCoordinates[polygonIndexes.back() + 1]);
-                    polygonCoordinates.push_back(0.0f);
-                    polygonIndexes.push_back(polygonCoordinates.size());
+            // rubber band from the last vertex, snapped to the first vertex when the polygon is about to close
+            if (document.openObject != -1) {
+                unsigned int first = scene.offsets[document.openObject];
+                unsigned int last = first + scene.counts[document.openObject] - 1;
+                if (closesPolygon(scene, document.openObject, xValue, yValue)) {
+                    updatePreview(scene.x[last], scene.y[last], scene.x[first], scene.y[first]);
                 }
                 else {
-                    if (polygonCoordinates.size() > polygonIndexes.back() + 3) {
-                        polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                        polygonCoordinates.push_back(polygonCoordinates[polygonCoordinates.size() - 3]);
-                        polygonCoordinates.push_back(0.0f);
-                    }
-                    polygonCoordinates.push_back(xValue);
-                    polygonCoordinates.push_back(yValue);
-                    polygonCoordinates.push_back(0.0f);
+                    updatePreview(scene.x[last], scene.y[last], xValue, yValue);
                 }
             }
         }
-
-        // draw lines
-        if (polygonCoordinates.size() > polygonIndexes.back() + 3) {
-            glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(float)* polygonCoordinates.size(), &polygonCoordinates[0], GL_STATIC_DRAW);
-        }
-
-        if (temporary) {
-            polygonCoordinates.pop_back();
-            polygonCoordinates.pop_back();
-            polygonCoordinates.pop_back();
-            if (polygonCoordinates.size() > polygonIndexes.back() + 3) {
-                polygonCoordinates.pop_back();
-                polygonCoordinates.pop_back();
-                polygonCoordinates.pop_back();
+        else {
+            int finished = addPolygonPoint(document, xValue, yValue);
+            if (finished != -1) {
+                addDrawRange(finished);
             }
+            previewVertices = 0;
+
+            // draw lines
+            uploadScene();
         }
     }
     else if (drawMode == DrawMode::floodFill) {
-        int polygons = polygonIndexes.size() - 1;
-        for (int i = 0; i < polygons; ++i) {
-            bool inside = false;
-            for (int k = polygonIndexes[i] / 3, j = (polygonIndexes[i + 1]) / 3 - 1; k < (polygonIndexes[i + 1]) / 3; j = k++) {
-                if (((polygonCoordinates[k * 3 + 1] > yValue) != (polygonCoordinates[j * 3 + 1] > yValue)) &&
-                    (xValue < (polygonCoordinates[j * 3] - polygonCoordinates[k * 3]) * (yValue - polygonCoordinates[k * 3 + 1]) / (polygonCoordinates[j * 3 + 1] - polygonCoordinates[k * 3 + 1]) + polygonCoordinates[k * 3])) {
-                    inside = !inside;
-                }
-            }
-            if (inside) {
-                std::vector<float>* vector = new std::vector<float>;
-                filledPolygonCoordinates.push_back(vector);
-                for (int j = polygonIndexes[i]; j < polygonIndexes[i + 1]; ++j) {
-                    filledPolygonCoordinates.back()->push_back(polygonCoordinates[j]);
-                }
-
-                VAO.push_back(0);
-                VBO.push_back(0);
-                glGenBuffers(1, &(VBO.back()));
-                glGenVertexArrays(1, &(VAO.back()));
-                glBindVertexArray(VAO.back());
-                glBindBuffer(GL_ARRAY_BUFFER, VBO.back());
-                glBufferData(GL_ARRAY_BUFFER, sizeof(float) * filledPolygonCoordinates.back()->size(), filledPolygonCoordinates.back()->data(), GL_STATIC_DRAW);
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-            }
+        std::vector<unsigned int> fills, polygons;
+        floodFill(document, xValue, yValue, fills, polygons);
+        for (int k = 0; k < fills.size(); ++k) {
+            uploadFill(fills[k], document.triangulations[scene.ids[polygons[k]]]);
         }
+        uploadScene();
     }
 }
 
 void characterCallback(GLFWwindow* window, unsigned int codepoint) {
+    InputEvent event = { EventType::character };
+    event.value = codepoint;
+    recordInput(event);
     if (listenForKeyboardInput) {
+        frameDirty = true;
         if ((char)codepoint == ' ') {
             spaced = true;
         }
@@ -816,6 +1594,91 @@ void characterCallback(GLFWwindow* window, unsigned int codepoint) {
         
     }
 }
+bool keyPressed(GLFWwindow* window, int key) {
+    if (replaying) {
+        for (int k = 0; k < POLLED_KEY_COUNT; ++k) {
+            if (POLLED_KEYS[k] == key) {
+                return (replayKeys >> k) & 1;
+            }
+        }
+        return false;
+    }
+    return glfwGetKey(window, key) == GLFW_PRESS;
+}
+void cursorPosition(GLFWwindow* window, double* xpos, double* ypos) {
+    if (replaying) {
+        *xpos = replayCursorX;
+        *ypos = replayCursorY;
+    }
+    else {
+        glfwGetCursorPos(window, xpos, ypos);
+    }
+}
+void setCursor(GLFWwindow* window, GLFWcursor* cursor) {
+    // headless replays have no window
+    if (window != NULL) {
+        glfwSetCursor(window, cursor);
+    }
+}
+void recordInput(InputEvent event) {
+    if (recording) {
+        event.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recordingStart).count();
+        recordEvent(recorder, event);
+    }
+}
+bool replayFrame(GLFWwindow* window) {
+    // hands the recorded events to the callbacks up to the next frame, false once the recording is over
+    replayInput = false;
+    while (replayPosition < replayEvents.size()) {
+        const InputEvent& event = replayEvents[replayPosition++];
+        if (realtimeReplay) {
+            std::this_thread::sleep_until(replayStart + std::chrono::microseconds(event.time));
+        }
+        if (event.type == EventType::frame) {
+            return true;
+        }
+        if (!replayInput) {
+            replayInput = true;
+            replayInputTime = std::chrono::steady_clock::now();
+        }
+        if (event.type == EventType::cursor) {
+            replayCursorX = event.x;
+            replayCursorY = event.y;
+            cursorPositionCallback(window, event.x, event.y);
+        }
+        else if (event.type == EventType::mouseButton) {
+            replayCursorX = event.x;
+            replayCursorY = event.y;
+            mouseButtonCallback(window, event.button, event.action, event.mods);
+        }
+        else if (event.type == EventType::character) {
+            characterCallback(window, event.value);
+        }
+        else if (event.type == EventType::keys) {
+            replayKeys = event.value;
+        }
+        else if (event.type == EventType::drop) {
+            const char* paths[] = { event.path.c_str() };
+            dropCallback(window, 1, paths);
+        }
+    }
+    return false;
+}
+void printTimes(const char* name, std::vector<double> times) {
+    // count, mean and percentiles of times in milliseconds
+    if (times.empty()) {
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for (double time : times) {
+        total += time;
+    }
+    int count = times.size();
+    std::cout << name << ": " << count << ", mean: " << total / count << " ms, min: " << times[0]
+        << " ms, p50: " << times[count / 2] << " ms, p99: " << times[std::min(count - 1, count * 99 / 100)]
+        << " ms, max: " << times.back() << " ms" << std::endl;
+}
 
 void clearCharacterBuffer() {
     keyboardInput1.clear();
@@ -832,230 +1695,220 @@ void processTransformation(float x, float y) {
     float yMin = std::min(transformationWindowCoordinates[1], transformationWindowCoordinates[7]);
     float yMax = std::max(transformationWindowCoordinates[1], transformationWindowCoordinates[7]);
 
-    glm::mat4 trans;
+    double op[6];
+    transformationMatrix(transformation, x, y, SCR_WIDTH, SCR_HEIGHT, op);
+    transformSelection(document, threadPool, xMin, yMin, xMax, yMax, op);
 
-    if (transformation == Transformation::translation) {        
-        x /= SCR_WIDTH;
-        y /= SCR_HEIGHT;
-    }
-    else if (transformation == Transformation::shearX) {
-        x /= SCR_WIDTH;
-    }
-    else if (transformation == Transformation::shearY) {
-        x /= SCR_HEIGHT;
-    }
-    else if (transformation == Transformation::rotation) {
-        trans = glm::mat4(1.0f);
-        trans = glm::rotate(trans, glm::radians(-x), glm::vec3(0.0, 0.0, 1.0));
-    }
+    uploadTransforms();
+}
 
-    int polygons = polygonIndexes.size() - 1;
+void uploadScene() {
+    frameDirty = true;
+    // every column holds one 4 byte value per vertex
+    const char* columns[] = { (const char*)scene.x.data(), (const char*)scene.y.data(), (const char*)scene.objects.data() };
+    unsigned int size = scene.x.size();
 
-    for (int i = 0; i < linesCoordinates.size(); i += 6) {
-        if (linesCoordinates[i] >= xMin && linesCoordinates[i] <= xMax
-            && linesCoordinates[i + 1] >= yMin && linesCoordinates[i + 1] <= yMax
-            && linesCoordinates[i + 3] >= xMin && linesCoordinates[i + 3] <= xMax
-            && linesCoordinates[i + 4] >= yMin && linesCoordinates[i + 4] <= yMax) {
-            if (transformation == Transformation::reflectionX) {
-                linesCoordinates[i + 1] = -linesCoordinates[i + 1];
-                linesCoordinates[i + 4] = -linesCoordinates[i + 4];
-            }
-            else if (transformation == Transformation::reflectionY) {
-                linesCoordinates[i] = -linesCoordinates[i];
-                linesCoordinates[i + 3] = -linesCoordinates[i + 3];
-            }
-            else if (transformation == Transformation::reflectionOrigin) {
-                linesCoordinates[i] = -linesCoordinates[i];
-                linesCoordinates[i + 3] = -linesCoordinates[i + 3];
-                linesCoordinates[i + 1] = -linesCoordinates[i + 1];
-                linesCoordinates[i + 4] = -linesCoordinates[i + 4];
-            }
-            else if (transformation == Transformation::translation) {
-                linesCoordinates[i] += x;
-                linesCoordinates[i + 3] += x;
-                linesCoordinates[i + 1] += y;
-                linesCoordinates[i + 4] += y;
-            }
-            else if (transformation == Transformation::scaling) {
-                linesCoordinates[i] *= x;
-                linesCoordinates[i + 3] *= x;
-                linesCoordinates[i + 1] *= y;
-                linesCoordinates[i + 4] *= y;
-            }
-            else if (transformation == Transformation::rotation) {
-                glm::vec4 vector = { linesCoordinates[i], linesCoordinates[i + 1], 0.0f, 1.0f };
-                vector = vector * trans;
-                linesCoordinates[i] = vector.x;
-                linesCoordinates[i + 1] = vector.y;
-
-                vector = { linesCoordinates[i + 3], linesCoordinates[i + 4], 0.0f, 1.0f };
-                vector = vector * trans;
-                linesCoordinates[i + 3] = vector.x;
-                linesCoordinates[i + 4] = vector.y;
-            }
-            else if (transformation == Transformation::shearX) {
-                linesCoordinates[i] += x * linesCoordinates[i + 1];
-                linesCoordinates[i + 3] += x * linesCoordinates[i + 4];
-            }
-            else if (transformation == Transformation::shearY) {
-                linesCoordinates[i + 1] += x * linesCoordinates[i];
-                linesCoordinates[i + 4] += x * linesCoordinates[i + 3];
+    if (size > sceneCapacity) {
+        reserveScene(columns, size);
+    }
+    else {
+        coalesceDirty(document.sceneDirty, DIRTY_GAP);
+        for (int i = 0; i < sceneVBO.size(); ++i) {
+            glBindBuffer(GL_ARRAY_BUFFER, sceneVBO[i]);
+            for (int j = 0; j < document.sceneDirty.offsets.size(); ++j) {
+                // ranges may point past vertices dropped since they were marked
+                unsigned int offset = document.sceneDirty.offsets[j];
+                unsigned int end = std::min(offset + document.sceneDirty.counts[j], size);
+                if (offset < end) {
+                    glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * offset, sizeof(float) * (end - offset), columns[i] + sizeof(float) * offset);
+                }
             }
         }
     }
+    document.sceneDirty.offsets.clear();
+    document.sceneDirty.counts.clear();
+    uploadTransforms();
+}
 
-    for (int i = 0; i < polygons; ++i) {
-        bool inside = true;
-        for (int j = polygonIndexes[i]; j < polygonIndexes[i + 1]; j += 3) {
-            if (polygonCoordinates[j] < xMin || polygonCoordinates[j] > xMax || polygonCoordinates[j + 1] < yMin || polygonCoordinates[j + 1] > yMax) {
-                inside = false;
-                break;
+void reserveScene(const char* const* columns, unsigned int size) {
+    // grow geometrically, uploading everything once
+    sceneCapacity = std::max(size * 2, 4096u);
+    for (int i = 0; i < sceneVBO.size(); ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, sceneVBO[i]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * sceneCapacity, NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * size, columns[i]);
+    }
+}
+
+void reserveTransforms(unsigned int size) {
+    // leaves the transform buffer bound, for the caller to fill
+    transformCapacity = std::max(size * 2, 1024u);
+    glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * 8 * transformCapacity, NULL, GL_DYNAMIC_DRAW);
+}
+
+void uploadTransforms() {
+    frameDirty = true;
+    unsigned int size = scene.ids.size();
+    auto upload = [](unsigned int offset, unsigned int count) {
+        // the shader reads single precision rows, padded to four floats
+        std::vector<float> texels(8 * count, 0.0f);
+        for (unsigned int i = 0; i < count; ++i) {
+            const double* m = &scene.transforms[6 * (offset + i)];
+            for (int k = 0; k < 3; ++k) {
+                texels[8 * i + k] = (float)m[k];
+                texels[8 * i + 4 + k] = (float)m[3 + k];
             }
         }
-        if (inside) {
-            for (int j = polygonIndexes[i]; j < polygonIndexes[i + 1]; j += 3) {
-                if (transformation == Transformation::reflectionX) {
-                    polygonCoordinates[j + 1] = -polygonCoordinates[j + 1];
-                }
-                else if (transformation == Transformation::reflectionY) {
-                    polygonCoordinates[j] = -polygonCoordinates[j];
-                }
-                else if (transformation == Transformation::reflectionOrigin) {
-                    polygonCoordinates[j] = -polygonCoordinates[j];
-                    polygonCoordinates[j + 1] = -polygonCoordinates[j + 1];
-                }
-                else if (transformation == Transformation::translation) {
-                    polygonCoordinates[j] += x;
-                    polygonCoordinates[j + 1] += y;
-                }
-                else if (transformation == Transformation::scaling) {
-                    polygonCoordinates[j] *= x;
-                    polygonCoordinates[j + 1] *= y;
-                }
-                else if (transformation == Transformation::rotation) {
-                    glm::vec4 vector = { polygonCoordinates[j], polygonCoordinates[j + 1], 0.0f, 1.0f };
-                    vector = vector * trans;
-                    polygonCoordinates[j] = vector.x;
-                    polygonCoordinates[j + 1] = vector.y;
-                }
-                else if (transformation == Transformation::shearX) {
-                    polygonCoordinates[j] += x * polygonCoordinates[j + 1];
-                }
-                else if (transformation == Transformation::shearY) {
-                    polygonCoordinates[j + 1] += x * polygonCoordinates[j];
-                }
+        glBufferSubData(GL_TEXTURE_BUFFER, sizeof(float) * 8 * offset, sizeof(float) * 8 * count, texels.data());
+    };
+
+    glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+    if (size > transformCapacity) {
+        reserveTransforms(size);
+        upload(0, size);
+    }
+    else {
+        // ranges are in objects, nearby objects are usually selected together
+        coalesceDirty(document.transformDirty, DIRTY_GAP / 8);
+        for (int j = 0; j < document.transformDirty.offsets.size(); ++j) {
+            unsigned int offset = document.transformDirty.offsets[j];
+            unsigned int end = std::min(offset + document.transformDirty.counts[j], size);
+            if (offset < end) {
+                upload(offset, end - offset);
             }
         }
     }
+    document.transformDirty.offsets.clear();
+    document.transformDirty.counts.clear();
+}
 
-    for (int i = 0; i < filledPolygonCoordinates.size(); ++i) {
-        bool inside = true;
-        for (auto j = filledPolygonCoordinates[i]->begin(); j != filledPolygonCoordinates[i]->end(); j += 3) {
-            if (*j < xMin || *j > xMax || *(j + 1) < yMin || *(j + 1) > yMax) {
-                inside = false;
-                break;
-            }
+void addDrawRange(int object) {
+    // fills are drawn from the arena instead
+    if (scene.types[object] != ObjectType::fill) {
+        DrawList* drawList = scene.types[object] == ObjectType::line ? &lineDrawList : &polygonDrawList;
+        drawList->firsts.push_back(scene.offsets[object]);
+        drawList->counts.push_back(scene.counts[object]);
+    }
+}
+
+void rebuildDrawLists() {
+    lineDrawList.firsts.clear();
+    lineDrawList.counts.clear();
+    polygonDrawList.firsts.clear();
+    polygonDrawList.counts.clear();
+    for (int i = 0; i < scene.ids.size(); ++i) {
+        if (i != document.openObject) {
+            addDrawRange(i);
         }
-        if (inside) {
-            for (auto j = filledPolygonCoordinates[i]->begin(); j != filledPolygonCoordinates[i]->end(); j += 3) {
-                if (transformation == Transformation::reflectionX) {
-                    *(j + 1) = -*(j + 1);
-                }
-                else if (transformation == Transformation::reflectionY) {
-                    *j = -*j;
-                }
-                else if (transformation == Transformation::reflectionOrigin) {
-                    *j = -*j;
-                    *(j + 1) = -*(j + 1);
-                }
-                else if (transformation == Transformation::translation) {
-                    *j += x;
-                    *(j + 1) += y;
-                }
-                else if (transformation == Transformation::scaling) {
-                    *j *= x;
-                    *(j + 1) *= y;
-                }
-                else if (transformation == Transformation::rotation) {
-                    glm::vec4 vector = { *j, *(j + 1), 0.0f, 1.0f };
-                    vector = vector * trans;
-                    *j = vector.x;
-                    *(j + 1) = vector.y;
-                }
-                else if (transformation == Transformation::shearX) {
-                    *j += x * *(j + 1);
-                }
-                else if (transformation == Transformation::shearY) {
-                    *(j + 1) += x * *j;
-                }
-            }
+    }
+}
+
+unsigned int allocateFill(FillArena& arena, unsigned int count) {
+    // grow geometrically, moving the old contents on the GPU
+    if (arena.top + count > arena.capacity) {
+        unsigned int capacity = std::max(std::max(arena.capacity * 2, arena.top + count), 1024u);
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * capacity, NULL, GL_STATIC_DRAW);
+        if (arena.top > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, arena.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(unsigned int) * arena.top);
         }
+        glDeleteBuffers(1, &arena.buffer);
+        arena.buffer = buffer;
+        arena.capacity = capacity;
+        glBindVertexArray(sceneVAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.buffer);
     }
 
-    if (!linesCoordinates.empty()) {
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * linesCoordinates.size(), &linesCoordinates[0], GL_STATIC_DRAW);
+    unsigned int offset = arena.top;
+    arena.top += count;
+    return offset;
+}
+
+void uploadFill(int object, const std::vector<unsigned int>& triangles) {
+    // triangles are numbered from the fill's first vertex
+    std::vector<unsigned int> indices(triangles.size());
+    unsigned int first = scene.offsets[object];
+    for (int k = 0; k < triangles.size(); ++k) {
+        indices[k] = first + triangles[k];
     }
-    if (polygons > 0) {
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * polygonCoordinates.size(), &polygonCoordinates[0], GL_STATIC_DRAW);
+
+    // a fill uploaded again is written over its own range, its triangulation is cached by polygon so the size
+    // stays the same, otherwise it takes a new range and the old one stays unused until the arena is reset
+    unsigned int id = scene.ids[object];
+    auto found = fillArena.entries.insert(std::make_pair(id, (unsigned int)fillArena.objects.size()));
+    unsigned int entry = found.first->second;
+    if (found.second) {
+        fillArena.objects.push_back(id);
+        fillArena.counts.push_back(0);
+        fillArena.offsets.push_back(NULL);
     }
-    for (int i = 0; i < filledPolygonCoordinates.size(); ++i) {
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[i + 5]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float)* filledPolygonCoordinates[i]->size(), filledPolygonCoordinates[i]->data(), GL_STATIC_DRAW);
+    unsigned int offset = (unsigned int)((size_t)fillArena.offsets[entry] / sizeof(unsigned int));
+    if (fillArena.counts[entry] != indices.size()) {
+        offset = allocateFill(fillArena, indices.size());
+        fillArena.counts[entry] = indices.size();
+        fillArena.offsets[entry] = (const void*)(sizeof(unsigned int) * offset);
+    }
+
+    if (!indices.empty()) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, fillArena.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * offset, sizeof(unsigned int) * indices.size(), indices.data());
     }
 }
 
-void normalizeCoordinates(float *x, float *y) {
-    *x = (2.0f / (float)SCR_WIDTH) * *x - 1;
-    // flip Y coordinate
-    *y = -((2.0f / (float)SCR_HEIGHT) * *y - 1);
+void clearFills() {
+    fillArena.top = 0;
+    fillArena.objects.clear();
+    fillArena.counts.clear();
+    fillArena.offsets.clear();
+    fillArena.entries.clear();
+}
+
+void updatePreview(float x1, float y1, float x2, float y2) {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[3]);
+    if (++previewSlot == PREVIEW_SLOTS) {
+        // orphan the ring so the driver never waits on frames still reading it
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * PREVIEW_SLOTS, NULL, GL_STREAM_DRAW);
+        previewSlot = 0;
+    }
+    float* vertices = (float*)glMapBufferRange(GL_ARRAY_BUFFER, sizeof(float) * 6 * previewSlot, sizeof(float) * 6,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (vertices != NULL) {
+        vertices[0] = x1;
+        vertices[1] = y1;
+        vertices[2] = 0.0f;
+        vertices[3] = x2;
+        vertices[4] = y2;
+        vertices[5] = 0.0f;
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    previewVertices = 2;
 }
 
 void renderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color) {
+    // queue the quads, they are drawn with the rest of the frame's text in flushText
+    layoutText(characters, text, x, y, scale, glm::value_ptr(color), SCR_WIDTH, SCR_HEIGHT, textVertices);
+}
 
-    // convert x and y to coords
-    x *= SCR_WIDTH;
-    y *= SCR_HEIGHT;
+void flushText() {
+    if (textVertices.empty()) {
+        return;
+    }
 
     glUseProgram(textShaderProgram);
-    glUniform3f(glGetUniformLocation(textShaderProgram, "textColor"), color.x, color.y, color.z);
     glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO[3]);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glBindVertexArray(VAO[1]);
+
+    // orphan last frame's storage and upload every queued quad at once
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * textVertices.size(), textVertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, textVertices.size() / 7);
+    textVertices.clear();
 
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
-    {
-        Character ch = characters[*c];
-
-        GLfloat xpos = x + ch.bearing.x * scale;
-        GLfloat ypos = y - (ch.size.y - ch.bearing.y) * scale;
-
-        GLfloat w = ch.size.x * scale;
-        GLfloat h = ch.size.y * scale;
-        // update VBO for each character
-        GLfloat vertices[6][4] = {
-            { xpos / SCR_WIDTH,     (ypos + h) / SCR_HEIGHT,   0.0, 0.0 },
-            { xpos / SCR_WIDTH,     ypos / SCR_HEIGHT,       0.0, 1.0 },
-            { (xpos + w) / SCR_WIDTH, ypos / SCR_HEIGHT,       1.0, 1.0 },
-
-            { xpos / SCR_WIDTH,     (ypos + h) / SCR_HEIGHT,   0.0, 0.0 },
-            { (xpos + w) / SCR_WIDTH, ypos / SCR_HEIGHT,       1.0, 1.0 },
-            { (xpos + w) / SCR_WIDTH, (ypos + h) / SCR_HEIGHT,   1.0, 0.0 }
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.textureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[3]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.advance >> 6)* scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
-    }
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
 }
\ No newline at end of file
@@ -7,6 +7,21 @@ const char* vertexShaderSource = "#version 330 core\n"
 "   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
 "}\0";
 
+// scene vertex shader code, coordinates come from separate x and y buffers,
+// each object's affine is fetched as two rows from the transform buffer
+const char* sceneVertexShaderSource = "#version 330 core\n"
+"layout (location = 0) in float aX;\n"
+"layout (location = 1) in float aY;\n"
+"layout (location = 2) in uint aObject;\n"
+"uniform samplerBuffer transforms;\n"
+"void main()\n"
+"{\n"
+"   vec3 position = vec3(aX, aY, 1.0);\n"
+"   vec4 row0 = texelFetch(transforms, int(aObject) * 2);\n"
+"   vec4 row1 = texelFetch(transforms, int(aObject) * 2 + 1);\n"
+"   gl_Position = vec4(dot(row0.xyz, position), dot(row1.xyz, position), 0.0, 1.0);\n"
+"}\0";
+
 // fragment shader code
 const char* fragmentShaderSource = "#version 330 core\n"
 "out vec4 FragColor;\n"
@@ -17,20 +32,42 @@ const char* fragmentShaderSource = "#version 330 core\n"
 
 const char* textVertexShaderSource = "#version 330 core\n"
 "layout(location = 0) in vec4 vertex; \n"
+"layout(location = 1) in vec3 color; \n"
 "out vec2 TexCoords; \n"
+"out vec3 TextColor; \n"
 "void main()\n"
 "{\n"
 "    gl_Position = vec4(vertex.xy, 0.0, 1.0);\n"
 "    TexCoords = vertex.zw; \n"
+"    TextColor = color; \n"
 "}\0";
 
 const char* textFragmentShaderSource = "#version 330 core\n"
 "in vec2 TexCoords; \n"
+"in vec3 TextColor; \n"
 "out vec4 color;\n"
 "uniform sampler2D text; \n"
-"uniform vec3 textColor; \n"
 "void main()\n"
 "{\n"
 "    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r); \n"
-"    color = vec4(textColor, 1.0) * sampled; \n"
+"    color = vec4(TextColor, 1.0) * sampled; \n"
+"}\0";
+
+// cached menu image, drawn as one textured quad
+const char* blitVertexShaderSource = "#version 330 core\n"
+"layout(location = 0) in vec4 vertex; \n"
+"out vec2 TexCoords; \n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(vertex.xy, 0.0, 1.0);\n"
+"    TexCoords = vertex.zw; \n"
+"}\0";
+
+const char* blitFragmentShaderSource = "#version 330 core\n"
+"in vec2 TexCoords; \n"
+"out vec4 color;\n"
+"uniform sampler2D image; \n"
+"void main()\n"
+"{\n"
+"    color = texture(image, TexCoords); \n"
 "}\0";
\ No newline at end of file
@@ -0,0 +1,521 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "core/core.h"
+
+// times the core operations behind the editor on a generated scene, and writes the results as JSON
+//   cg-benchmark [--lines N] [--polygons N] [--polygon-vertices N] [--queries N] [--fills N]
+//                [--threads N] [--repeat N] [--seed N] [--output results.json]
+
+// one timed operation, count is how many units of work it did
+struct Result {
+    std::string name;
+    double count;
+    double seconds;
+    // anything else worth reporting, written as extra fields
+    std::vector<std::pair<std::string, double>> extra;
+};
+
+// canvas the editor starts with, the transformation parameters are given in its pixels
+const unsigned int CANVAS_WIDTH = 700;
+const unsigned int CANVAS_HEIGHT = 700;
+const int GRID_SIZE = 64;
+// same gaps uploadScene and uploadTransforms coalesce with
+const unsigned int DIRTY_GAP = 256;
+const unsigned int KERNEL_VERTICES = 1 << 20;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void uploadVolume(DirtyRanges& dirty, unsigned int gap, unsigned int bytes, const std::string& name, Result& result) {
+    // what the next upload would send, then forgets it like the upload does
+    coalesceDirty(dirty, gap);
+    double total = 0.0;
+    for (unsigned int count : dirty.counts) {
+        total += (double)count * bytes;
+    }
+    result.extra.push_back(std::make_pair(name + "_bytes", total));
+    result.extra.push_back(std::make_pair(name + "_ranges", (double)dirty.offsets.size()));
+    dirty.offsets.clear();
+    dirty.counts.clear();
+}
+
+void writeResults(std::ostream& out, const std::vector<std::pair<std::string, double>>& settings, const std::string& instructionSet, const std::vector<Result>& results) {
+    out << "{\n";
+    for (auto& setting : settings) {
+        out << "  \"" << setting.first << "\": " << setting.second << ",\n";
+    }
+    out << "  \"instruction_set\": \"" << instructionSet << "\",\n";
+    out << "  \"results\": [\n";
+    for (int i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << "    { \"name\": \"" << result.name << "\", \"count\": " << result.count << ", \"seconds\": " << result.seconds
+            << ", \"per_second\": " << (result.seconds > 0.0 ? result.count / result.seconds : 0.0);
+        for (auto& field : result.extra) {
+            out << ", \"" << field.first << "\": " << field.second;
+        }
+        out << (i + 1 < results.size() ? " },\n" : " }\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char** argv) {
+    unsigned int lines = 5000;
+    unsigned int polygons = 1000;
+    unsigned int polygonVertices = 8;
+    unsigned int queries = 100000;
+    unsigned int fillCount = 200;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int repeat = 10;
+    unsigned int seed = 1;
+    const char* output = NULL;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--output" && i + 1 < argc) {
+            output = argv[++i];
+            continue;
+        }
+        unsigned int* value = NULL;
+        if (argument == "--lines") value = &lines;
+        else if (argument == "--polygons") value = &polygons;
+        else if (argument == "--polygon-vertices") value = &polygonVertices;
+        else if (argument == "--queries") value = &queries;
+        else if (argument == "--fills") value = &fillCount;
+        else if (argument == "--threads") value = &threads;
+        else if (argument == "--repeat") value = &repeat;
+        else if (argument == "--seed") value = &seed;
+        if (value == NULL || i + 1 >= argc) {
+            std::cout << "Unknown argument " << argument << std::endl;
+            return -1;
+        }
+        *value = strtoul(argv[++i], NULL, 10);
+    }
+    polygonVertices = std::max(3u, polygonVertices);
+    threads = std::max(1u, threads);
+    repeat = std::max(1u, repeat);
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-0.9f, 0.9f);
+    std::uniform_real_distribution<float> canvas(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> length(0.01f, 0.2f);
+    std::uniform_real_distribution<float> radius(0.05f, 0.12f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * (float)acos(-1.0));
+
+    // every click is generated up front, so only the document calls are timed
+    std::vector<float> lineClicks;
+    for (unsigned int i = 0; i < lines; ++i) {
+        float x = position(random), y = position(random), a = angle(random), l = length(random);
+        lineClicks.push_back(x);
+        lineClicks.push_back(y);
+        lineClicks.push_back(x + l * cos(a));
+        lineClicks.push_back(y + l * sin(a));
+    }
+    // convex outlines around a center, the closing click lands on the first vertex, the radius keeps
+    // the vertices across from it far enough away to be placed
+    std::vector<float> polygonClicks, centers;
+    std::vector<unsigned int> polygonSizes;
+    for (unsigned int i = 0; i < polygons; ++i) {
+        float x = position(random), y = position(random), r = radius(random), start = angle(random);
+        unsigned int size = 0;
+        float firstX = 0.0f, firstY = 0.0f;
+        for (unsigned int k = 0; k < polygonVertices; ++k) {
+            float a = start + k * 2.0f * (float)acos(-1.0) / polygonVertices;
+            float vx = x + r * cos(a), vy = y + r * sin(a);
+            if (k == 0) {
+                firstX = vx;
+                firstY = vy;
+            }
+            else if (fabs(vx - firstX) < 0.05f && fabs(vy - firstY) < 0.05f) {
+                // would close the polygon early
+                continue;
+            }
+            polygonClicks.push_back(vx);
+            polygonClicks.push_back(vy);
+            size++;
+        }
+        polygonClicks.push_back(firstX);
+        polygonClicks.push_back(firstY);
+        polygonSizes.push_back(size);
+        centers.push_back(x);
+        centers.push_back(y);
+    }
+
+    Document document;
+    initDocument(document, GRID_SIZE);
+    ThreadPool pool;
+    startThreadPool(pool, threads);
+    selectTransformKernel();
+    std::vector<Result> results;
+
+    // insertion, two clicks per line
+    {
+        Result result = { "insert_lines", (double)lineClicks.size() / 2 };
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < lineClicks.size(); i += 2) {
+            addLinePoint(document, lineClicks[i], lineClicks[i + 1]);
+        }
+        result.seconds = secondsSince(start);
+        results.push_back(result);
+    }
+
+    // polygon vertices and the closing clicks, which index the polygon, are timed apart
+    {
+        Result insert = { "insert_polygon_vertices", 0.0, 0.0 };
+        Result close = { "close_polygons", (double)polygons, 0.0 };
+        unsigned int click = 0;
+        for (unsigned int i = 0; i < polygons; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int k = 0; k < polygonSizes[i]; ++k, click += 2) {
+                addPolygonPoint(document, polygonClicks[click], polygonClicks[click + 1]);
+            }
+            insert.seconds += secondsSince(start);
+            insert.count += polygonSizes[i];
+
+            start = std::chrono::steady_clock::now();
+            int closed = addPolygonPoint(document, polygonClicks[click], polygonClicks[click + 1]);
+            close.seconds += secondsSince(start);
+            click += 2;
+            if (closed == -1) {
+                std::cout << "Polygon " << i << " did not close" << std::endl;
+                return -1;
+            }
+        }
+        results.push_back(insert);
+        results.push_back(close);
+    }
+
+    // what the first upload after drawing everything would send, three 4 byte columns per vertex
+    {
+        Result result = { "upload_scene", (double)document.scene.x.size(), 0.0 };
+        auto start = std::chrono::steady_clock::now();
+        uploadVolume(document.sceneDirty, DIRTY_GAP, 12, "upload", result);
+        result.seconds = secondsSince(start);
+        uploadVolume(document.transformDirty, DIRTY_GAP / 8, 32, "transform_upload", result);
+        results.push_back(result);
+    }
+
+    // hit tests at random points, as the fill tool does before it copies anything
+    {
+        std::vector<float> points;
+        for (unsigned int i = 0; i < 2 * queries; ++i) {
+            points.push_back(canvas(random));
+        }
+        Result result = { "point_in_polygon", (double)queries, 0.0 };
+        std::vector<unsigned int> hits;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < queries; ++i) {
+            polygonsAtPoint(document, points[2 * i], points[2 * i + 1], hits);
+        }
+        result.seconds = secondsSince(start);
+        result.extra.push_back(std::make_pair("hits", (double)hits.size()));
+        results.push_back(result);
+    }
+
+    // fills at polygon centers, including triangulation
+    {
+        unsigned int count = std::min(fillCount, polygons);
+        Result result = { "flood_fill", (double)count, 0.0 };
+        std::vector<unsigned int> fills, filled;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; ++i) {
+            floodFill(document, centers[2 * i], centers[2 * i + 1], fills, filled);
+        }
+        result.seconds = secondsSince(start);
+        result.extra.push_back(std::make_pair("fills", (double)fills.size()));
+        uploadVolume(document.sceneDirty, DIRTY_GAP, 12, "upload", result);
+        uploadVolume(document.transformDirty, DIRTY_GAP / 8, 32, "transform_upload", result);
+        results.push_back(result);
+    }
+
+    // every transformation over the middle of the canvas, the transforms and the grid are put back
+    // after each repetition so every one of them selects the same objects
+    struct Operation {
+        const char* name;
+        Transformation transformation;
+        float x, y;
+    };
+    Operation operations[] = {
+        { "translation", Transformation::translation, 10.0f, 5.0f },
+        { "scaling", Transformation::scaling, 1.25f, 0.8f },
+        { "rotation", Transformation::rotation, 15.0f, 0.0f },
+        { "reflection_x", Transformation::reflectionX, 0.0f, 0.0f },
+        { "reflection_y", Transformation::reflectionY, 0.0f, 0.0f },
+        { "reflection_origin", Transformation::reflectionOrigin, 0.0f, 0.0f },
+        { "shear_x", Transformation::shearX, 20.0f, 0.0f },
+        { "shear_y", Transformation::shearY, 20.0f, 0.0f }
+    };
+    {
+        std::vector<double> transforms = document.scene.transforms;
+        SpatialGrid grid = document.grid;
+        for (const Operation& operation : operations) {
+            double op[6];
+            transformationMatrix(operation.transformation, operation.x, operation.y, CANVAS_WIDTH, CANVAS_HEIGHT, op);
+
+            Result result = { std::string("transform_") + operation.name, 0.0, 0.0 };
+            for (unsigned int r = 0; r < repeat; ++r) {
+                auto start = std::chrono::steady_clock::now();
+                result.count += transformSelection(document, pool, -0.5f, -0.5f, 0.5f, 0.5f, op);
+                result.seconds += secondsSince(start);
+                if (r + 1 == repeat) {
+                    uploadVolume(document.transformDirty, DIRTY_GAP / 8, 32, "transform_upload", result);
+                }
+                document.transformDirty.offsets.clear();
+                document.transformDirty.counts.clear();
+                document.scene.transforms = transforms;
+                document.grid = grid;
+            }
+            results.push_back(result);
+        }
+    }
+
+    // every transformation of everything baked into the vertices, with the kernel picked for its kind and
+    // with the general kernel for every kind as the baseline, taking turns so neither runs on a warmer cache,
+    // each bake works on a fresh copy. Baking also rebounds and reindexes the objects, so the kernels alone
+    // are timed over the same vertices too
+    std::vector<float> bakedX(document.scene.x.size()), bakedY(document.scene.y.size());
+    for (const Operation& operation : operations) {
+        double op[6];
+        transformationMatrix(operation.transformation, operation.x, operation.y, CANVAS_WIDTH, CANVAS_HEIGHT, op);
+        float single[6] = { (float)op[0], (float)op[1], (float)op[2], (float)op[3], (float)op[4], (float)op[5] };
+        // the general kernel first, then the one for the kind
+        TransformKernel kernels[2] = { transformKernelFor(bestInstructionSet(), AffineKind::general), transformKernel(single) };
+        Document transformed = document;
+        transformSelection(transformed, pool, -1.0f, -1.0f, 1.0f, 1.0f, op);
+        double bakeSeconds[2] = { 0.0, 0.0 }, kernelSeconds[2] = { 0.0, 0.0 };
+        for (unsigned int r = 0; r < repeat; ++r) {
+            for (int specialized = 0; specialized < 2; ++specialized) {
+                auto start = std::chrono::steady_clock::now();
+                kernels[specialized](single, document.scene.x.data(), document.scene.y.data(), bakedX.data(), bakedY.data(), bakedX.size());
+                kernelSeconds[specialized] += secondsSince(start);
+
+                selectTransformKernel(specialized == 1);
+                Document baked = transformed;
+                start = std::chrono::steady_clock::now();
+                bakeTransforms(baked, pool);
+                bakeSeconds[specialized] += secondsSince(start);
+            }
+        }
+        selectTransformKernel();
+        Result result = { std::string("bake_") + operation.name, (double)document.scene.x.size() * repeat, bakeSeconds[1] };
+        result.extra.push_back(std::make_pair("general_seconds", bakeSeconds[0]));
+        result.extra.push_back(std::make_pair("speedup", bakeSeconds[1] > 0.0 ? bakeSeconds[0] / bakeSeconds[1] : 0.0));
+        result.extra.push_back(std::make_pair("kernel_seconds", kernelSeconds[1]));
+        result.extra.push_back(std::make_pair("kernel_general_seconds", kernelSeconds[0]));
+        results.push_back(result);
+    }
+
+    // baking a rotation of everything into the vertices
+    {
+        double op[6];
+        transformationMatrix(Transformation::rotation, 30.0f, 0.0f, CANVAS_WIDTH, CANVAS_HEIGHT, op);
+        transformSelection(document, pool, -1.0f, -1.0f, 1.0f, 1.0f, op);
+        Result result = { "bake_transforms", (double)document.scene.x.size(), 0.0 };
+        auto start = std::chrono::steady_clock::now();
+        bakeTransforms(document, pool);
+        result.seconds = secondsSince(start);
+        uploadVolume(document.sceneDirty, DIRTY_GAP, 12, "upload", result);
+        uploadVolume(document.transformDirty, DIRTY_GAP / 8, 32, "transform_upload", result);
+        results.push_back(result);
+    }
+
+    // writing the scene to a file and reading it back into a second document, per vertex
+    {
+        const char* path = "cg-benchmark.cgs";
+        Result save = { "save_scene", (double)document.scene.x.size(), 0.0 };
+        Result load = { "load_scene", (double)document.scene.x.size(), 0.0 };
+        Document loaded;
+        initDocument(loaded, GRID_SIZE);
+        std::vector<unsigned int> fills, filled;
+        for (unsigned int r = 0; r < repeat; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            bool saved = saveScene(document, pool, path);
+            save.seconds += secondsSince(start);
+            fills.clear();
+            filled.clear();
+            start = std::chrono::steady_clock::now();
+            if (!saved || !loadScene(loaded, pool, path, fills, filled)) {
+                return -1;
+            }
+            load.seconds += secondsSince(start);
+        }
+        save.count *= repeat;
+        load.count *= repeat;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        save.extra.push_back(std::make_pair("file_bytes", (double)file.tellg()));
+        load.extra.push_back(std::make_pair("fills", (double)fills.size()));
+        file.close();
+        std::remove(path);
+        results.push_back(save);
+        results.push_back(load);
+    }
+
+    // the same through the uncompressed file that is mapped, opening includes reading it in
+    {
+        const char* path = "cg-benchmark.cgsm";
+        Result save = { "save_mapped_scene", (double)document.scene.x.size(), 0.0 };
+        Result open = { "open_mapped_scene", (double)document.scene.x.size(), 0.0 };
+        Result load = { "load_mapped_scene", (double)document.scene.x.size(), 0.0 };
+        Document loaded;
+        initDocument(loaded, GRID_SIZE);
+        std::vector<unsigned int> fills, filled;
+        for (unsigned int r = 0; r < repeat; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            bool saved = saveMappedScene(document, path);
+            save.seconds += secondsSince(start);
+            MappedScene mapped;
+            start = std::chrono::steady_clock::now();
+            if (!saved || !openMappedScene(mapped, path)) {
+                return -1;
+            }
+            open.seconds += secondsSince(start);
+            fills.clear();
+            filled.clear();
+            start = std::chrono::steady_clock::now();
+            bool read = loadMappedScene(loaded, pool, mapped, fills, filled);
+            load.seconds += secondsSince(start);
+            closeMappedScene(mapped);
+            if (!read) {
+                return -1;
+            }
+        }
+        save.count *= repeat;
+        open.count *= repeat;
+        load.count *= repeat;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        save.extra.push_back(std::make_pair("file_bytes", (double)file.tellg()));
+        load.extra.push_back(std::make_pair("fills", (double)fills.size()));
+        file.close();
+        std::remove(path);
+        results.push_back(save);
+        results.push_back(open);
+        results.push_back(load);
+    }
+
+    // exporting the canvas to SVG and importing that file into a second document, per vertex
+    {
+        const char* path = "cg-benchmark.svg";
+        Result exported = { "export_svg", (double)document.scene.x.size(), 0.0 };
+        Result imported = { "import_svg", 0.0, 0.0 };
+        for (unsigned int r = 0; r < repeat; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            if (!exportSvg(document, path, CANVAS_WIDTH, CANVAS_HEIGHT)) {
+                return -1;
+            }
+            exported.seconds += secondsSince(start);
+            Document loaded;
+            initDocument(loaded, GRID_SIZE);
+            Importer importer;
+            ImportBatch batch;
+            start = std::chrono::steady_clock::now();
+            if (!startImport(importer, path, CANVAS_WIDTH, CANVAS_HEIGHT)) {
+                return -1;
+            }
+            while (importRunning(importer)) {
+                if (takeImportBatch(importer, batch)) {
+                    appendImportBatch(loaded, batch);
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+            stopImport(importer);
+            imported.seconds += secondsSince(start);
+            imported.count += loaded.scene.x.size();
+        }
+        exported.count *= repeat;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        exported.extra.push_back(std::make_pair("file_bytes", (double)file.tellg()));
+        file.close();
+        std::remove(path);
+        results.push_back(exported);
+        results.push_back(imported);
+    }
+
+    // raw kernel throughput for every instruction set the processor has, per kind of affine
+    {
+        std::vector<float> xs(KERNEL_VERTICES), ys(KERNEL_VERTICES), outX(KERNEL_VERTICES), outY(KERNEL_VERTICES);
+        for (unsigned int j = 0; j < KERNEL_VERTICES; ++j) {
+            xs[j] = canvas(random);
+            ys[j] = canvas(random);
+        }
+        const char* setNames[] = { "scalar", "sse2", "avx2" };
+        const char* kindNames[] = { "translation", "scaling", "general" };
+        float matrices[3][6] = {
+            { 1.0f, 0.0f, 0.1f, 0.0f, 1.0f, -0.1f },
+            { 1.5f, 0.0f, 0.1f, 0.0f, 0.5f, -0.1f },
+            { 0.8f, -0.6f, 0.1f, 0.6f, 0.8f, -0.1f }
+        };
+        for (unsigned int set = 0; set < 3; ++set) {
+            for (unsigned int kind = 0; kind < 3; ++kind) {
+                TransformKernel kernel = transformKernelFor((InstructionSet)set, (AffineKind)kind);
+                if (kernel == NULL) {
+                    continue;
+                }
+                Result result = { std::string("kernel_") + setNames[set] + "_" + kindNames[kind], (double)KERNEL_VERTICES * repeat, 0.0 };
+                auto start = std::chrono::steady_clock::now();
+                for (unsigned int r = 0; r < repeat; ++r) {
+                    kernel(matrices[kind], xs.data(), ys.data(), outX.data(), outY.data(), KERNEL_VERTICES);
+                }
+                result.seconds = secondsSince(start);
+                results.push_back(result);
+            }
+        }
+    }
+
+    // text layout against made up glyph metrics, a menu line per frame
+    {
+        std::map<char, Glyph> glyphs;
+        for (int c = 32; c < 127; ++c) {
+            float u = (c - 32) / 95.0f;
+            Glyph glyph = { { u, 0.0f }, { u + 0.01f, 1.0f }, { 10, 14 }, { 1, 12 }, 11 << 6 };
+            glyphs.insert(std::make_pair((char)c, glyph));
+        }
+        std::string text = "Press T to translate, S to scale, R to rotate, X or Y to reflect";
+        float color[3] = { 1.0f, 1.0f, 1.0f };
+        unsigned int frames = 1000 * repeat;
+        Result result = { "text_layout", (double)text.size() * frames, 0.0 };
+        std::vector<float> vertices;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int f = 0; f < frames; ++f) {
+            vertices.clear();
+            layoutText(glyphs, text, -0.9f, 0.9f, 0.5f, color, CANVAS_WIDTH, CANVAS_HEIGHT, vertices);
+        }
+        result.seconds = secondsSince(start);
+        result.extra.push_back(std::make_pair("bytes_per_frame", (double)sizeof(float) * vertices.size()));
+        results.push_back(result);
+    }
+    stopThreadPool(pool);
+
+    std::vector<std::pair<std::string, double>> settings = {
+        { "lines", (double)lines },
+        { "polygons", (double)polygons },
+        { "polygon_vertices", (double)polygonVertices },
+        { "vertices", (double)document.scene.x.size() },
+        { "objects", (double)document.scene.ids.size() },
+        { "threads", (double)threads },
+        { "repeat", (double)repeat },
+        { "seed", (double)seed }
+    };
+    const char* setNames[] = { "scalar", "sse2", "avx2" };
+    if (output != NULL) {
+        std::ofstream file(output);
+        if (!file) {
+            std::cout << "Failed to write " << output << std::endl;
+            return -1;
+        }
+        writeResults(file, settings, setNames[(unsigned int)bestInstructionSet()], results);
+    }
+    else {
+        writeResults(std::cout, settings, setNames[(unsigned int)bestInstructionSet()], results);
+    }
+    return 0;
+}